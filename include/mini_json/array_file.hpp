@@ -0,0 +1,280 @@
+#pragma once
+#include "json.hpp"
+#include "node.hpp"
+#include "splitter.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace mini_json {
+
+/**
+ * array_file reads the elements of a top-level array from a file one by one
+ * the file is read in chunks and each element is parsed on its own,
+ * so memory is bounded by the chunk and the largest element, not the file
+ *
+ *     json::array_file records("export.json");
+ *     for (auto& rec : records)
+ *         handle(rec);
+ *     if (records.errp() != json::json::error_code::non)
+ *         ...
+ */
+class array_file {
+
+public:
+    /**
+     * chunk is the size of every read
+     * prefetch is the number of elements parsed ahead on a background thread,
+     * zero parses on the calling thread
+     */
+    struct options {
+        std::size_t chunk = 1 << 20;
+        std::size_t prefetch = 0;
+    };
+
+    class iterator;
+
+private:
+    std::ifstream fs;
+    std::string buf;
+    std::string_view rest;
+    bool ended = false;
+    splitter split;
+    json elem_parser;
+    json::error_code err = json::error_code::non;
+
+    // elements parsed ahead by worker, guarded by lock
+    std::size_t ahead = 0;
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<node> queue;
+    bool finished = false;
+    bool stopping = false;
+
+    node current;
+
+public:
+    explicit array_file(std::string const& path)
+        : array_file(path, options {})
+    {
+    }
+
+    array_file(std::string const& path, options opts)
+        : fs(path, std::ios::binary)
+        , buf(opts.chunk ? opts.chunk : 1, '\0')
+        , ahead(opts.prefetch)
+    {
+    }
+
+    array_file(array_file const&) = delete;
+    array_file& operator=(array_file const&) = delete;
+
+    ~array_file()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        cond.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool is_open() const
+    {
+        return fs.is_open();
+    }
+
+    /**
+     * the parser of every element, configure it before the first read
+     * (depth_limit, project, pack_numbers), see json::parse_element
+     */
+    json& parser() noexcept
+    {
+        return elem_parser;
+    }
+
+    /**
+     * move the next element into out
+     * returns false at the end of the array or on errors, see errp
+     */
+    bool next(node& out);
+
+    /**
+     * error of the file, non after a complete array
+     * and expect_value, as for empty input, when it could not be opened
+     * only meaningful once next returned false
+     */
+    json::error_code errp() const noexcept
+    {
+        return err;
+    }
+
+    iterator begin();
+    iterator end() noexcept;
+
+private:
+    bool produce(node& out);
+    void prefetch();
+};
+
+/**
+ * iterator is a single pass input iterator over the elements
+ * the element it refers to is replaced by the next increment
+ */
+class array_file::iterator {
+
+private:
+    array_file* file = nullptr;
+
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = node;
+    using difference_type = std::ptrdiff_t;
+    using pointer = node*;
+    using reference = node&;
+
+    iterator() = default;
+
+    explicit iterator(array_file* init)
+        : file(init)
+    {
+        ++*this;
+    }
+
+    node& operator*() const noexcept
+    {
+        return file->current;
+    }
+
+    node* operator->() const noexcept
+    {
+        return &file->current;
+    }
+
+    iterator& operator++()
+    {
+        if (!file->next(file->current))
+            file = nullptr;
+        return *this;
+    }
+
+    bool operator==(iterator const& rhs) const noexcept
+    {
+        return file == rhs.file;
+    }
+
+    bool operator!=(iterator const& rhs) const noexcept
+    {
+        return file != rhs.file;
+    }
+};
+
+inline array_file::iterator array_file::begin()
+{
+    return iterator(this);
+}
+
+inline array_file::iterator array_file::end() noexcept
+{
+    return iterator();
+}
+
+inline bool array_file::next(node& out)
+{
+    if (!fs.is_open()) {
+        err = json::error_code::expect_value;
+        return false;
+    }
+
+    if (ahead == 0)
+        return produce(out);
+
+    // started lazily, so parser() can still be configured before
+    if (!worker.joinable() && !finished)
+        worker = std::thread([this] { prefetch(); });
+
+    std::unique_lock<std::mutex> guard(lock);
+    cond.wait(guard, [&] { return !queue.empty() || finished; });
+    if (queue.empty())
+        return false;
+
+    out = std::move(queue.front());
+    queue.pop_front();
+    cond.notify_all();
+    return true;
+}
+
+/**
+ * produce reads until the next element is complete and parses it
+ */
+inline bool array_file::produce(node& out)
+{
+    while (err == json::error_code::non) {
+        rest.remove_prefix(split.feed(rest));
+
+        if (split.ready()) {
+            node* elem = elem_parser.parse_element(split.element());
+            split.pop();
+            if (!elem) {
+                err = elem_parser.errp();
+                return false;
+            }
+            out = std::move(*elem);
+            return true;
+        }
+
+        if (split.error() != json::error_code::non) {
+            err = split.error();
+            return false;
+        }
+
+        if (!rest.empty())
+            continue;
+
+        if (ended) {
+            err = split.finish();
+            return false;
+        }
+
+        fs.read(buf.data(), std::streamsize(buf.size()));
+        rest = std::string_view(buf.data(), std::size_t(fs.gcount()));
+        ended = rest.empty();
+    }
+    return false;
+}
+
+/**
+ * prefetch runs on worker and keeps up to ahead elements queued
+ * err is published to the reader by finished under the lock
+ */
+inline void array_file::prefetch()
+{
+    while (true) {
+        node elem;
+        bool got = produce(elem);
+
+        std::unique_lock<std::mutex> guard(lock);
+        cond.wait(guard, [&] { return stopping || queue.size() < ahead; });
+        if (stopping)
+            return;
+
+        if (!got) {
+            finished = true;
+            cond.notify_all();
+            return;
+        }
+
+        queue.push_back(std::move(elem));
+        cond.notify_all();
+    }
+}
+
+}; // namespace mini_json
@@ -0,0 +1,304 @@
+#pragma once
+#include "json.hpp"
+#include "splitter.hpp"
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * coroutine front end of the parser, which needs C++20
+ * the rest of mini_json stays C++17 and never includes this header
+ *
+ * a byte source is any type whose read() returns an awaitable of std::string_view
+ * the view stays valid until the next read, and an empty view ends the input
+ */
+
+namespace mini_json {
+
+/**
+ * task is a lazy coroutine returning T
+ * awaiting it starts the body and resumes the awaiter once it returns,
+ * start() runs it from ordinary code until its first suspension
+ */
+template <typename T>
+class task {
+
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> next = std::noop_coroutine();
+
+        task get_return_object() noexcept
+        {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct finish {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept
+                {
+                    return self.promise().next;
+                }
+
+                void await_resume() noexcept
+                {
+                }
+            };
+            return finish {};
+        }
+
+        template <typename U>
+        void return_value(U&& val)
+        {
+            value.emplace(std::forward<U>(val));
+        }
+
+        void unhandled_exception() noexcept
+        {
+            error = std::current_exception();
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit task(std::coroutine_handle<promise_type> init) noexcept
+        : handle(init)
+    {
+    }
+
+public:
+    task(task&& src) noexcept
+        : handle(std::exchange(src.handle, nullptr))
+    {
+    }
+
+    task& operator=(task&& src) noexcept
+    {
+        if (this != &src) {
+            if (handle)
+                handle.destroy();
+            handle = std::exchange(src.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    void start()
+    {
+        handle.resume();
+    }
+
+    bool done() const noexcept
+    {
+        return handle.done();
+    }
+
+    /**
+     * value of a finished task, rethrows what its body threw
+     */
+    T result()
+    {
+        auto& prom = handle.promise();
+        if (prom.error)
+            std::rethrow_exception(prom.error);
+        return std::move(*prom.value);
+    }
+
+    bool await_ready() const noexcept
+    {
+        return handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        handle.promise().next = caller;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        return result();
+    }
+};
+
+/**
+ * channel is an in-memory byte source
+ * a reader finding it empty suspends until the producer pushes or closes,
+ * the producer resumes the reader inline, so one thread can drive
+ * any number of channels and their parsers
+ */
+class channel {
+
+private:
+    std::deque<std::string> chunks;
+    std::string current;
+    std::coroutine_handle<> waiter;
+    bool ended = false;
+
+    void wake()
+    {
+        if (auto next = std::exchange(waiter, nullptr); next)
+            next.resume();
+    }
+
+public:
+    void push(std::string chunk)
+    {
+        if (chunk.empty())
+            return;
+        chunks.push_back(std::move(chunk));
+        wake();
+    }
+
+    void close()
+    {
+        ended = true;
+        wake();
+    }
+
+    auto read()
+    {
+        struct reading {
+            channel& src;
+
+            bool await_ready() const noexcept
+            {
+                return !src.chunks.empty() || src.ended;
+            }
+
+            void await_suspend(std::coroutine_handle<> reader) noexcept
+            {
+                src.waiter = reader;
+            }
+
+            std::string_view await_resume()
+            {
+                if (src.chunks.empty())
+                    return {};
+                src.current = std::move(src.chunks.front());
+                src.chunks.pop_front();
+                return src.current;
+            }
+        };
+        return reading { *this };
+    }
+};
+
+/**
+ * parse_buffered reads src to its end into one buffer, then parses it
+ * the caller is suspended, not blocked, while input is missing
+ * it is a convenience wrapper: the parser is not resumable, so the whole
+ * document is held in memory, only array_reader keeps one element at a time
+ * returns the root owned by parser or nullptr, see json::parse
+ */
+template <typename Source>
+task<node*> parse_buffered(json& parser, Source& src)
+{
+    std::string buf;
+    while (true) {
+        std::string_view chunk = co_await src.read();
+        if (chunk.empty())
+            break;
+        buf.append(chunk);
+    }
+    co_return parser.parse(buf);
+}
+
+/**
+ * array_reader parses the elements of a top-level array from src one by one
+ * only the element being read is buffered, see splitter
+ * elements are parsed with json::parse_element, so the depth limit
+ * and the items rule of the schema apply as in a whole parse
+ */
+template <typename Source>
+class array_reader {
+
+private:
+    json& parser;
+    Source& src;
+    splitter split;
+    std::string_view rest;
+    bool ended = false;
+    json::error_code err = json::error_code::non;
+
+public:
+    array_reader(json& init_parser, Source& init_src)
+        : parser(init_parser)
+        , src(init_src)
+    {
+    }
+
+    /**
+     * the next element owned by parser, valid until the next call
+     * nullptr at the end of the array or on errors, see errp
+     * the array ends at its closing bracket, so src is never read past
+     * the chunk holding it, and the rest of that chunk must be whitespace
+     */
+    task<node*> next();
+
+    json::error_code errp() const noexcept
+    {
+        return err;
+    }
+};
+
+template <typename Source>
+task<node*> array_reader<Source>::next()
+{
+    while (err == json::error_code::non) {
+        rest.remove_prefix(split.feed(rest));
+
+        if (split.ready()) {
+            node* elem = parser.parse_element(split.element());
+            split.pop();
+            if (!elem)
+                err = parser.errp();
+            co_return elem;
+        }
+
+        if (split.error() != json::error_code::non) {
+            err = split.error();
+            break;
+        }
+
+        // a keep-alive source may stay open after the array
+        if (split.closed())
+            break;
+
+        if (!rest.empty())
+            continue;
+
+        if (ended) {
+            err = split.finish();
+            break;
+        }
+
+        rest = co_await src.read();
+        ended = rest.empty();
+    }
+    co_return nullptr;
+}
+
+}; // namespace mini_json
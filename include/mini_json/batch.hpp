@@ -0,0 +1,382 @@
+#pragma once
+#include "json.hpp"
+#include "node.hpp"
+#include "scan.hpp"
+#include "splitter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace mini_json {
+
+/**
+ * batch parses many independent documents on a pool of worker threads
+ * every worker owns a json parser whose buffers stay warm across batches
+ * and a deque of tasks, idle workers steal from the others
+ *
+ * top-level arrays of at least split_bytes are cut into pieces of elements
+ * which are parsed in parallel, so one huge document cannot stall a batch
+ */
+class batch {
+
+public:
+    /**
+     * threads of zero uses every hardware thread
+     */
+    struct options {
+        std::size_t threads = 0;
+        std::size_t split_bytes = 1 << 20;
+    };
+
+    /**
+     * result of one document, converts to true when it was parsed
+     * code and offset are those of json::errp and json::errpos
+     */
+    struct result {
+        node value;
+        json::error_code code = json::error_code::non;
+        std::size_t offset = 0;
+
+        explicit operator bool() const noexcept
+        {
+            return code == json::error_code::non;
+        }
+    };
+
+private:
+    constexpr static std::size_t whole = std::size_t(-1);
+
+    // a split document, its elements are parsed into arr by pieces
+    struct split_doc {
+        std::vector<node> arr;
+        // position of the opening bracket, then of every separator
+        std::vector<std::size_t> bounds;
+        std::atomic<std::size_t> left { 0 };
+        std::mutex err_lock;
+        json::error_code code = json::error_code::non;
+        std::size_t offset = 0;
+    };
+
+    // one call of parse_many, deleted by the task finishing its last document
+    struct job {
+        std::vector<std::string_view> docs;
+        std::vector<result> results;
+        std::vector<std::unique_ptr<split_doc>> splits;
+        std::atomic<std::size_t> remaining { 0 };
+        std::promise<std::vector<result>> done;
+    };
+
+    // a whole document, or the elements [first, last) of a split one
+    struct task {
+        job* owner;
+        std::size_t doc;
+        std::size_t first;
+        std::size_t last;
+    };
+
+    struct worker {
+        std::mutex lock;
+        std::deque<task> tasks;
+        json parser;
+        splitter split;
+    };
+
+    std::size_t split_min;
+    std::vector<std::unique_ptr<worker>> workers;
+    std::vector<std::thread> threads;
+
+    // sleeping workers wait for queued to become positive
+    std::mutex idle_lock;
+    std::condition_variable idle;
+    std::atomic<std::size_t> queued { 0 };
+    bool stopping = false;
+
+public:
+    batch()
+        : batch(options {})
+    {
+    }
+
+    explicit batch(options opts)
+        : split_min(opts.split_bytes)
+    {
+        std::size_t count = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+        count = count ? count : 1;
+
+        for (std::size_t i = 0; i < count; i++)
+            workers.push_back(std::make_unique<worker>());
+        for (std::size_t i = 0; i < count; i++)
+            threads.emplace_back([this, i] { run(i); });
+    }
+
+    batch(batch const&) = delete;
+    batch& operator=(batch const&) = delete;
+
+    /**
+     * queued jobs are finished before the workers stop,
+     * so pending futures of parse_many_async still get their results
+     */
+    ~batch()
+    {
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+            stopping = true;
+        }
+        idle.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    /**
+     * apply fn to the parser of every worker, for instance to set a projection
+     * only call it while no batch is running
+     */
+    template <typename Fn>
+    void configure(Fn&& fn)
+    {
+        for (auto& each : workers)
+            fn(each->parser);
+    }
+
+    /**
+     * parse every document, results are in the order of docs
+     * the documents only need to outlive the call
+     */
+    std::vector<result> parse_many(std::vector<std::string_view> const& docs)
+    {
+        return parse_many_async(docs).get();
+    }
+
+    /**
+     * parse_many without waiting, the documents must outlive the future
+     */
+    std::future<std::vector<result>> parse_many_async(std::vector<std::string_view> docs);
+
+private:
+    void push(std::size_t at, task next);
+    bool take(std::size_t self, task& out);
+    void run(std::size_t self);
+    void parse_whole(worker& self, task const& cur);
+    bool parse_split(std::size_t self, task const& cur);
+    void parse_piece(worker& self, task const& cur);
+    void finish(job* owner);
+};
+
+inline std::future<std::vector<batch::result>> batch::parse_many_async(std::vector<std::string_view> docs)
+{
+    auto owner = new job();
+    owner->docs = std::move(docs);
+    owner->results.resize(owner->docs.size());
+    owner->splits.resize(owner->docs.size());
+    auto ret = owner->done.get_future();
+
+    std::size_t count = owner->docs.size();
+    if (count == 0) {
+        owner->done.set_value({});
+        delete owner;
+        return ret;
+    }
+    owner->remaining = count;
+
+    // largest documents at the back, where every owner starts taking
+    std::vector<std::size_t> order(count);
+    for (std::size_t i = 0; i < count; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return owner->docs[lhs].size() < owner->docs[rhs].size();
+    });
+
+    for (std::size_t i = 0; i < count; i++)
+        push(i % workers.size(), { owner, order[i], whole, whole });
+    return ret;
+}
+
+inline void batch::push(std::size_t at, task next)
+{
+    {
+        std::lock_guard<std::mutex> guard(workers[at]->lock);
+        workers[at]->tasks.push_back(next);
+    }
+    {
+        std::lock_guard<std::mutex> guard(idle_lock);
+        ++queued;
+    }
+    idle.notify_one();
+}
+
+/**
+ * take pops the newest task of self, otherwise steals the oldest of another worker
+ */
+inline bool batch::take(std::size_t self, task& out)
+{
+    for (std::size_t i = 0; i < workers.size(); i++) {
+        auto& from = *workers[(self + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(from.lock);
+        if (from.tasks.empty())
+            continue;
+
+        if (i == 0) {
+            out = from.tasks.back();
+            from.tasks.pop_back();
+        } else {
+            out = from.tasks.front();
+            from.tasks.pop_front();
+        }
+        --queued;
+        return true;
+    }
+    return false;
+}
+
+inline void batch::run(std::size_t self)
+{
+    while (true) {
+        task cur;
+        if (take(self, cur)) {
+            if (cur.first != whole)
+                parse_piece(*workers[self], cur);
+            else if (!parse_split(self, cur))
+                parse_whole(*workers[self], cur);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(idle_lock);
+        idle.wait(guard, [&] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
+
+inline void batch::parse_whole(worker& self, task const& cur)
+{
+    auto& res = cur.owner->results[cur.doc];
+    if (node* root = self.parser.parse(cur.owner->docs[cur.doc]); root) {
+        res.value = std::move(*root);
+    } else {
+        res.code = self.parser.errp();
+        res.offset = self.parser.errpos();
+    }
+    finish(cur.owner);
+}
+
+/**
+ * parse_split frames the elements of a large top-level array
+ * and queues them in pieces of about split_bytes / 4
+ * returns false when the document is parsed as a whole instead
+ */
+inline bool batch::parse_split(std::size_t self, task const& cur)
+{
+    auto text = cur.owner->docs[cur.doc];
+    if (text.size() < split_min || split_min == 0)
+        return false;
+
+    // the root array alone exceeds a zero limit, report it where a whole parse does
+    auto& parser = workers[self]->parser;
+    if (parser.depth_limit() == 0)
+        return false;
+
+    // pieces cannot check constraints on the root array as a whole
+    if (!parser.conform().empty())
+        return false;
+
+    auto open = scan::ws(text.data(), text.data() + text.size());
+    if (open == text.data() + text.size() || *open != '[')
+        return false;
+
+    auto doc = std::make_unique<split_doc>();
+    auto& bounds = doc->bounds;
+    bounds.push_back(std::size_t(open - text.data()));
+
+    // framing is a plain scan, grammar errors are left to the parser
+    auto& split = workers[self]->split;
+    split.reset();
+    std::size_t pos = 0;
+    while (pos < text.size() && split.error() == json::error_code::non) {
+        pos += split.feed(text.substr(pos));
+        if (split.ready()) {
+            bounds.push_back(pos - 1);
+            split.pop();
+        }
+    }
+
+    // malformed or tiny arrays get their exact error from a whole parse
+    if (split.finish() != json::error_code::non || bounds.size() < 3)
+        return false;
+
+    std::size_t elems = bounds.size() - 1;
+    doc->arr.resize(elems);
+
+    std::size_t piece = split_min / 4 ? split_min / 4 : 1;
+    std::vector<task> pieces;
+    for (std::size_t first = 0; first < elems;) {
+        std::size_t last = first + 1;
+        while (last < elems && bounds[last] - bounds[first] < piece)
+            ++last;
+        pieces.push_back({ cur.owner, cur.doc, first, last });
+        first = last;
+    }
+
+    doc->left = pieces.size();
+    cur.owner->splits[cur.doc] = std::move(doc);
+    for (auto const& next : pieces)
+        push(self, next);
+    return true;
+}
+
+inline void batch::parse_piece(worker& self, task const& cur)
+{
+    auto text = cur.owner->docs[cur.doc];
+    auto& doc = *cur.owner->splits[cur.doc];
+
+    for (std::size_t i = cur.first; i < cur.last; i++) {
+        std::size_t st = doc.bounds[i] + 1;
+        node* root = self.parser.parse_element(text.substr(st, doc.bounds[i + 1] - st));
+        if (root) {
+            doc.arr[i] = std::move(*root);
+            continue;
+        }
+
+        // the first error in the text wins, like a whole parse would report
+        std::lock_guard<std::mutex> guard(doc.err_lock);
+        std::size_t offset = st + self.parser.errpos();
+        if (doc.code == json::error_code::non || offset < doc.offset) {
+            doc.code = self.parser.errp();
+            doc.offset = offset;
+        }
+        break;
+    }
+
+    if (doc.left.fetch_sub(1) != 1)
+        return;
+
+    auto& res = cur.owner->results[cur.doc];
+    res.code = doc.code;
+    res.offset = doc.offset;
+    if (doc.code == json::error_code::non) {
+        res.value.assign(std::move(doc.arr));
+        // the same rule as a whole parse of the array
+        if (self.parser.pack_numbers())
+            res.value.pack();
+    }
+    cur.owner->splits[cur.doc].reset();
+    finish(cur.owner);
+}
+
+inline void batch::finish(job* owner)
+{
+    if (owner->remaining.fetch_sub(1) != 1)
+        return;
+
+    owner->done.set_value(std::move(owner->results));
+    delete owner;
+}
+
+}; // namespace mini_json
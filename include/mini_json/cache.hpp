@@ -0,0 +1,216 @@
+#pragma once
+#include "json.hpp"
+#include "node.hpp"
+#include "scan.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mini_json {
+
+/**
+ * parse_cache remembers the trees of recently parsed inputs
+ * byte-identical inputs are found by a hash of the bytes and one full compare,
+ * and get a frozen copy of the cached tree instead of being parsed again
+ *
+ * the cache is split into shards by hash, each with its own lock and LRU list
+ * the cached tree depends on the parser options (projection, packed numbers),
+ * so use one cache per configuration
+ *
+ *     json::parse_cache cache;
+ *     if (auto res = cache.parse(parser, body); res)
+ *         handle(res.value); // mutation unshares, the cached tree never changes
+ */
+class parse_cache {
+
+public:
+    /**
+     * capacity is the number of entries of the whole cache
+     * inputs longer than max_input are parsed but never kept
+     */
+    struct options {
+        std::size_t capacity = 1024;
+        std::size_t shards = 16;
+        std::size_t max_input = 1 << 20;
+    };
+
+    /**
+     * result of one input, converts to true when it was parsed
+     * code and offset are those of json::errp and json::errpos
+     */
+    struct result {
+        node value;
+        json::error_code code = json::error_code::non;
+        std::size_t offset = 0;
+
+        explicit operator bool() const noexcept
+        {
+            return code == json::error_code::non;
+        }
+    };
+
+    struct counters {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+private:
+    // the text of key points into the entry, which list nodes keep in place
+    struct key {
+        std::size_t hash;
+        std::string_view text;
+
+        bool operator==(key const& rhs) const noexcept
+        {
+            return hash == rhs.hash && text.size() == rhs.text.size()
+                && std::memcmp(text.data(), rhs.text.data(), text.size()) == 0;
+        }
+    };
+
+    struct key_hash {
+        std::size_t operator()(key const& val) const noexcept
+        {
+            return val.hash;
+        }
+    };
+
+    struct entry {
+        std::string text;
+        std::size_t hash;
+        node value;
+    };
+
+    // the front of lru is the most recently used entry
+    struct shard {
+        std::mutex lock;
+        std::list<entry> lru;
+        std::unordered_map<key, std::list<entry>::iterator, key_hash> index;
+    };
+
+    std::size_t per_shard;
+    std::size_t max_input;
+    std::vector<std::unique_ptr<shard>> shards;
+
+    std::atomic<std::size_t> hits { 0 };
+    std::atomic<std::size_t> misses { 0 };
+
+public:
+    parse_cache()
+        : parse_cache(options {})
+    {
+    }
+
+    explicit parse_cache(options opts)
+        : max_input(opts.max_input)
+    {
+        std::size_t count = opts.shards ? opts.shards : 1;
+        per_shard = (opts.capacity + count - 1) / count;
+        for (std::size_t i = 0; i < count; i++)
+            shards.push_back(std::make_unique<shard>());
+    }
+
+    parse_cache(parse_cache const&) = delete;
+    parse_cache& operator=(parse_cache const&) = delete;
+
+    /**
+     * look text up, or parse it with parser and keep the tree
+     * the lock is not held while parsing, so parser must only be used by the caller
+     * failed inputs are not kept
+     */
+    result parse(json& parser, std::string_view text);
+
+    /**
+     * number of lookups which found or missed their input
+     */
+    counters stats() const noexcept
+    {
+        return { hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed) };
+    }
+
+    std::size_t size() const;
+
+    /**
+     * drop every entry, copies handed out stay valid
+     */
+    void clear();
+
+private:
+    shard& shard_of(std::size_t hash) noexcept
+    {
+        // the low bits pick the bucket inside a shard, so use the high ones
+        return *shards[(hash >> 48) % shards.size()];
+    }
+};
+
+inline parse_cache::result parse_cache::parse(json& parser, std::string_view text)
+{
+    std::size_t hash = scan::hash(text.data(), text.data() + text.size(), 0);
+    auto& part = shard_of(hash);
+
+    {
+        std::lock_guard<std::mutex> guard(part.lock);
+        if (auto found = part.index.find({ hash, text }); found != part.index.end()) {
+            part.lru.splice(part.lru.begin(), part.lru, found->second);
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return { found->second->value };
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    result ret;
+    node* root = parser.parse(text);
+    if (!root) {
+        ret.code = parser.errp();
+        ret.offset = parser.errpos();
+        return ret;
+    }
+
+    ret.value = std::move(*root);
+    ret.value.freeze();
+    if (text.size() > max_input || per_shard == 0)
+        return ret;
+
+    std::lock_guard<std::mutex> guard(part.lock);
+    // another thread may have parsed the same input meanwhile
+    if (part.index.count({ hash, text }))
+        return ret;
+
+    part.lru.push_front({ std::string(text), hash, ret.value });
+    auto& front = part.lru.front();
+    part.index.emplace(key { hash, front.text }, part.lru.begin());
+
+    if (part.lru.size() > per_shard) {
+        auto& back = part.lru.back();
+        part.index.erase({ back.hash, back.text });
+        part.lru.pop_back();
+    }
+    return ret;
+}
+
+inline std::size_t parse_cache::size() const
+{
+    std::size_t ret = 0;
+    for (auto const& part : shards) {
+        std::lock_guard<std::mutex> guard(part->lock);
+        ret += part->lru.size();
+    }
+    return ret;
+}
+
+inline void parse_cache::clear()
+{
+    for (auto& part : shards) {
+        std::lock_guard<std::mutex> guard(part->lock);
+        part->index.clear();
+        part->lru.clear();
+    }
+}
+
+}; // namespace mini_json
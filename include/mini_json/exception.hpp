@@ -27,4 +27,20 @@ public:
     }
 };
 
+class bad_write : public std::exception {
+public:
+    char const* what() const noexcept override
+    {
+        return "json_writer call does not fit the structure written so far";
+    }
+};
+
+class bad_schema : public std::exception {
+public:
+    char const* what() const noexcept override
+    {
+        return "schema document uses an unsupported or malformed keyword";
+    }
+};
+
 };
\ No newline at end of file
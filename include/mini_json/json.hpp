@@ -1,10 +1,40 @@
 #pragma once
 #include "node.hpp"
+#include "projection.hpp"
+#include "scan.hpp"
+#include "schema.hpp"
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+/**
+ * statistics are collected only when MINI_JSON_STATS is defined before including
+ * otherwise MINI_JSON_COUNT discards its argument and the hot loops stay untouched
+ * the macro changes the bodies of inline members, so define it the same way
+ * in every translation unit of a program, best on the compiler command line
+ * MINI_JSON_COUNT is private to this header and undefined at its end
+ */
+#ifdef MINI_JSON_STATS
+#define MINI_JSON_COUNT(expr) (expr)
+#else
+#define MINI_JSON_COUNT(expr) ((void)0)
+#endif
 
 namespace mini_json {
 
+// defined in reclaim.hpp, which only users of json::reclaim include
+class reclaimer;
+
 /**
  * json provides the parsing and stringing manipulation
  */
@@ -22,42 +52,194 @@ public:
         invalid_value,
         miss_separator,
         invalid_escape,
+        depth_exceeded,
+        invalid_utf8,
+        schema_violation,
+    };
+
+    /**
+     * result of validate, converts to true when the input is valid
+     * offset is the byte where the error was detected
+     */
+    struct validation {
+        error_code code = error_code::non;
+        std::size_t offset = 0;
+
+        explicit operator bool() const noexcept
+        {
+            return code == error_code::non;
+        }
+    };
+
+    /**
+     * statistics of the last parse and the last str call
+     * all fields stay zero unless MINI_JSON_STATS is defined
+     * allocations only cover containers grown by the parser itself
+     */
+    struct statistics {
+        // reset by every parse
+        std::size_t bytes_consumed = 0;
+        std::array<std::size_t, node::data_t::len()> nodes {};
+        std::size_t max_depth = 0;
+        std::size_t strings_escaped = 0;
+        std::size_t strings_plain = 0;
+        std::size_t allocations = 0;
+        std::size_t bytes_allocated = 0;
+        std::size_t values_skipped = 0;
+        std::chrono::nanoseconds parse_time {};
+
+        // reset by every str
+        std::size_t bytes_written = 0;
+        std::size_t fragments_reused = 0;
+        std::size_t bytes_reused = 0;
+        std::chrono::nanoseconds str_time {};
+
+        std::size_t nodes_total() const noexcept
+        {
+            std::size_t ret = 0;
+            for (auto num : nodes)
+                ret += num;
+            return ret;
+        }
     };
 
+    constexpr static bool stats_enabled =
+#ifdef MINI_JSON_STATS
+        true;
+#else
+        false;
+#endif
+
 private:
     std::unique_ptr<node> root = nullptr;
     std::unique_ptr<std::string> string = nullptr;
     std::string context;
-    std::string::iterator context_it;
+    char const* begin = nullptr;
+    char const* cur = nullptr;
+    char const* end = nullptr;
+    bool parsed = false;
     error_code perr = error_code::non;
     error_code serr = error_code::non;
+    std::size_t perr_pos = 0;
+    statistics stat;
+    std::chrono::steady_clock::time_point stat_start;
+
+    // scratch buffers stay warm between parses
+    std::string scratch;
+    std::string key_scratch;
+
+    /**
+     * open containers while parsing and stringing
+     * both are kept on the heap, so the nesting depth never touches the call stack
+     * a parse frame refers to its container by index into values,
+     * the children follow it there until the container is closed
+     * proj is the projection entry of the container, see projection
+     * rule is its schema rule and seen the required members found so far
+     */
+    struct parse_frame {
+        std::size_t slot;
+        std::size_t key_base;
+        std::size_t proj;
+        std::size_t rule;
+        std::uint64_t seen;
+        bool is_arr;
+    };
+
+    struct str_frame {
+        node const* cont;
+        std::size_t index;
+        node::obj_t::const_iterator member;
+        // where the text of a frozen container starts, npos when it is not cached
+        std::size_t from;
+    };
+
+    std::vector<parse_frame> parse_stack;
+    std::vector<str_frame> str_stack;
+    std::vector<node const*> size_stack;
+
+    /**
+     * runs referenced by str_gather instead of being copied
+     * offset is where the run belongs in string, pins keep cached texts alive
+     */
+    struct str_cut {
+        std::size_t offset;
+        std::string_view text;
+    };
+
+    std::size_t gather_min = 0;
+    std::vector<str_cut> cuts;
+    std::vector<std::shared_ptr<std::string const>> pins;
+    std::vector<std::string_view> segments;
+    std::size_t max_depth = 1024;
+    std::size_t cache_min = 0;
+    bool pack = false;
+    bool defer = false;
+    // the document is an element of a top-level array, see parse_element
+    bool as_element = false;
+    reclaimer* reclaim_by = nullptr;
+    void (*reclaim_drop)(reclaimer*, node&&) = nullptr;
+
+    // projection entry of the value parsed next, none skips it
+    projection proj;
+    std::size_t proj_next = projection::all;
+
+    // schema rule of the value parsed next
+    schema rules;
+    std::size_t rule_next = schema::any;
+
+    /**
+     * values and keys of open containers
+     * closing a container moves its children into one exact-size allocation
+     */
+    std::vector<node> values;
+    std::vector<std::string> keys;
 
 public:
+    /**
+     * a default constructed json is a reusable parser
+     * which is fed by parse(std::string_view)
+     */
+    json() = default;
+
     /**
      * json accept an context while construcing
      * which could copy or move from argument
      */
     json(std::string init)
         : context(std::move(init))
-        , context_it(context.begin())
     {
     }
 
     /**
      * parse operation will try to parse the context to root node
-     * which should return an optional
-     * the optional maybe hold a shared_ptr pointed to root node
+     * which returns the root node or nullptr on errors
      */
     node* parse()
     {
-        if (!root)
-            root = std::make_unique<node>();
+        return parse(context);
+    }
 
-        if (root && parse_value(*root))
-            return root.get();
+    /**
+     * parse the given input without copying it
+     * input only needs to outlive this call, the tree owns its data
+     * one json can parse any number of documents back-to-back
+     * the previous tree is replaced while buffers keep their capacity
+     */
+    node* parse(std::string_view input)
+    {
+        return parse_doc(input, false);
+    }
 
-        root = nullptr;
-        return nullptr;
+    /**
+     * parse input as one element of a top-level array, the way a whole
+     * parse of the array sees it: one level deeper against depth_limit
+     * and checked against the items rule of the schema, whose root must
+     * accept arrays, but not against constraints on the array as a whole
+     * batch and array_reader parse large arrays element by element with it
+     */
+    node* parse_element(std::string_view input)
+    {
+        return parse_doc(input, true);
     }
 
     /**
@@ -67,16 +249,75 @@ public:
      */
     std::string* str()
     {
+        if constexpr (stats_enabled) {
+            stat_start = std::chrono::steady_clock::now();
+            stat.fragments_reused = stat.bytes_reused = 0;
+        }
+
         if (!string)
             string = std::make_unique<std::string>();
+        else
+            string->clear();
+
+        // a cold buffer is allocated once at the exact size, a warm one
+        // keeps its capacity from earlier calls and is not measured again
+        if (parsed && !gather_min && string->capacity() <= std::string().capacity())
+            string->reserve(str_size());
+
+        bool ok = parsed && str_value(*root);
 
-        if (root && str_value(*root))
+        if constexpr (stats_enabled) {
+            stat.str_time = std::chrono::steady_clock::now() - stat_start;
+            stat.bytes_written = ok ? string->size() : 0;
+        }
+
+        if (ok)
             return string.get();
 
-        string = nullptr;
+        string->clear();
         return nullptr;
     }
 
+    /**
+     * str_size is the exact length of the output of str, found without writing it
+     * numbers are formatted into a small buffer, cached texts of frozen
+     * subtrees are only measured, and nothing is allocated once warm
+     */
+    std::size_t str_size();
+
+    /**
+     * str_gather strings the root like str, but clean runs of string values
+     * of at least min_run bytes are referred to in place instead of copied
+     * the segments concatenate to the output of str and map one to one
+     * onto iovec for writev or sendmsg
+     * they stay valid until the tree is mutated or destroyed, a lazy value
+     * is read (see lazy), or str or str_gather is called again
+     */
+    std::vector<std::string_view> const* str_gather(std::size_t min_run = 256)
+    {
+        cuts.clear();
+        pins.clear();
+        segments.clear();
+
+        gather_min = min_run ? min_run : 1;
+        std::string* out = str();
+        gather_min = 0;
+        if (!out)
+            return nullptr;
+
+        std::size_t pos = 0;
+        for (auto const& cut : cuts) {
+            if (cut.offset != pos)
+                segments.emplace_back(out->data() + pos, cut.offset - pos);
+            segments.push_back(cut.text);
+            pos = cut.offset;
+            MINI_JSON_COUNT(stat.bytes_written += cut.text.size());
+        }
+        if (pos != out->size())
+            segments.emplace_back(out->data() + pos, out->size() - pos);
+        return &segments;
+    }
+
     /**
      * get error code
      */
@@ -90,61 +331,562 @@ public:
         return serr;
     }
 
+    /**
+     * byte offset of the last parse error
+     */
+    std::size_t errpos() const noexcept
+    {
+        return perr_pos;
+    }
+
+    /**
+     * validate checks RFC 8259 grammar and UTF-8 well-formedness
+     * without building a tree and without any heap allocation
+     * open containers are tracked in a bitset of MaxDepth bits on the stack
+     */
+    template <std::size_t MaxDepth = 1024>
+    static validation validate(std::string_view input) noexcept;
+
+    /**
+     * maximum nesting depth accepted by parse
+     * deeper input fails with depth_exceeded
+     */
+    std::size_t depth_limit() const noexcept
+    {
+        return max_depth;
+    }
+
+    void depth_limit(std::size_t limit) noexcept
+    {
+        max_depth = limit;
+    }
+
+    /**
+     * projection applied by parse, empty by default which keeps everything
+     * skipped values are checked for terminated strings and balanced brackets
+     * but not for their full grammar
+     */
+    projection const& project() const noexcept
+    {
+        return proj;
+    }
+
+    void project(projection spec)
+    {
+        proj = std::move(spec);
+    }
+
+    /**
+     * schema checked by parse, empty by default which accepts everything
+     * types are checked at the first charactor of a value, scalars once parsed
+     * and containers once closed, so parse stops at the first violation
+     * with schema_violation, errpos is the start of a violating scalar,
+     * empty container or member and the end of other violating containers
+     */
+    schema const& conform() const noexcept
+    {
+        return rules;
+    }
+
+    void conform(schema spec)
+    {
+        rules = std::move(spec);
+    }
+
+    /**
+     * when enabled, parse stores non-empty arrays whose elements are all numbers
+     * as packed arrays (node::data_k::packed) holding one std::vector<double>,
+     * 8 bytes per element instead of a whole node
+     * read them with get<std::vector<double>>(), a mutable get of the array
+     * of nodes unpacks them and as() converts them like ordinary arrays
+     * enabling it changes what readers see: type() reports packed and a const
+     * get of the array of nodes throws bad_get, so tree walkers need a packed case
+     */
+    bool pack_numbers() const noexcept
+    {
+        return pack;
+    }
+
+    void pack_numbers(bool enable) noexcept
+    {
+        pack = enable;
+    }
+
+    /**
+     * when enabled, parse keeps numbers and escaped strings as their source text
+     * (node::data_k::raw) and decodes them on the first get or as,
+     * so values which are never read are only scanned
+     * str writes numbers back verbatim, big integers and long decimals
+     * survive a round trip exactly, and untouched strings keep their escapes
+     * strings without escapes are stored as usual, and raw numbers are never packed
+     */
+    bool lazy() const noexcept
+    {
+        return defer;
+    }
+
+    void lazy(bool enable) noexcept
+    {
+        defer = enable;
+    }
+
+    /**
+     * when set, parse hands the previous tree, and the value of a parse
+     * which fails after it, to gc instead of freeing them, see reclaimer
+     * the tree of the last parse is still freed with the parser
+     * the hand-off is bound where the caller passes gc and reclaim.hpp is
+     * included, so json.hpp itself only needs the declaration of reclaimer
+     */
+    reclaimer* reclaim() const noexcept
+    {
+        return reclaim_by;
+    }
+
+    template <typename Gc>
+    void reclaim(Gc* gc) noexcept
+    {
+        static_assert(std::is_same_v<Gc, reclaimer>, "mini_json::json::reclaim : expects a reclaimer");
+        reclaim_by = gc;
+        reclaim_drop = [](reclaimer* to, node&& tree) { static_cast<Gc*>(to)->drop(std::move(tree)); };
+    }
+
+    void reclaim(std::nullptr_t) noexcept
+    {
+        reclaim_by = nullptr;
+    }
+
+    /**
+     * incremental stringing of frozen trees
+     * when min_bytes is not zero, str keeps the text of every frozen subtree
+     * whose output reaches min_bytes inside the shared value, and later calls
+     * copy it instead of walking the subtree again
+     * mutation unshares the path to the change (see node::freeze),
+     * so only that path is regenerated while untouched siblings are copied
+     * nested subtrees hold their own copies, so prefer large thresholds
+     */
+    std::size_t str_cache() const noexcept
+    {
+        return cache_min;
+    }
+
+    void str_cache(std::size_t min_bytes) noexcept
+    {
+        cache_min = min_bytes;
+    }
+
+    /**
+     * get statistics of the last parse and str
+     */
+    statistics const& stats() const noexcept
+    {
+        return stat;
+    }
+
 private:
+    /**
+     * bookkeeping of statistics, only called when stats_enabled
+     */
+    void stat_parse_begin()
+    {
+        auto str_stat = stat;
+        stat = statistics();
+        stat.str_time = str_stat.str_time;
+        stat.bytes_written = str_stat.bytes_written;
+        stat.fragments_reused = str_stat.fragments_reused;
+        stat.bytes_reused = str_stat.bytes_reused;
+        stat_start = std::chrono::steady_clock::now();
+    }
+
+    void stat_parse_end()
+    {
+        stat.parse_time = std::chrono::steady_clock::now() - stat_start;
+        stat.bytes_consumed = cur - begin;
+    }
+
+    void count_node(node::data_k kind)
+    {
+        ++stat.nodes[static_cast<std::size_t>(kind)];
+    }
+
+    void count_alloc(std::size_t bytes)
+    {
+        ++stat.allocations;
+        stat.bytes_allocated += bytes;
+    }
+
+    // containers reallocate when an insertion finds them full
+    template <typename Container>
+    void count_growth(Container const& cont, std::size_t old_cap)
+    {
+        if (cont.capacity() != old_cap)
+            count_alloc(cont.capacity() * sizeof(typename Container::value_type));
+    }
+
+    // strings beyond the small string buffer own a heap block
+    void count_string(std::size_t len)
+    {
+        if (len > std::string().capacity())
+            count_alloc(len + 1);
+    }
+
+    void count_depth(std::size_t depth)
+    {
+        if (depth > stat.max_depth)
+            stat.max_depth = depth;
+    }
+
+    // append to a string being parsed, counting its reallocations
+    void put(std::string& str, char const* src, std::size_t len)
+    {
+        if constexpr (stats_enabled) {
+            auto cap = str.capacity();
+            str.append(src, len);
+            count_growth(str, cap);
+        } else {
+            str.append(src, len);
+        }
+    }
+
     /**
      * submethods about parsing
      */
+    char peek() const noexcept
+    {
+        return cur != end ? *cur : '\0';
+    }
+
+    // only whitespace may follow the root value
+    bool parse_end()
+    {
+        parse_ws();
+        if (cur == end)
+            return true;
+
+        perr = error_code::root_singular;
+        return false;
+    }
+
+    template <bool Decode = true>
+    bool parse_chars(std::string& out, bool& escaped);
+    template <bool Decode>
     bool parse_unicode(std::string& out);
     bool parse_key(std::string& str);
+    bool parse_object(bool& open);
+    bool parse_array(bool& open);
+    bool parse_next(bool& done);
     bool parse_literal(node& mnode);
-    bool parse_object(node& mnode);
     bool parse_string(node& mnode);
+    bool parse_raw(node& mnode);
     bool parse_number(node& mnode);
+    node* parse_doc(std::string_view input, bool element);
     bool parse_value(node& mnode);
-    bool parse_array(node& mnode);
+    bool parse_enter();
+    void parse_push(bool is_arr);
+    bool parse_member();
+    bool parse_skip();
+    void parse_close();
+    bool parse_packable(std::vector<node>::iterator first) const noexcept;
+    bool parse_violation();
     void parse_ws();
 
     // submethods about stringing
-    std::string str_string(std::string_view src);
-    bool str_literal(node& mnode);
-    bool str_object(node& mnode);
-    bool str_value(node& mnode);
-    bool str_array(node& mnode);
+    static std::size_t str_number(node::num_t val, char* buf) noexcept;
+    void str_string(std::string_view src);
+    void str_run(char const* first, char const* last);
+    void str_raw(node::raw_t const& val);
+    bool str_cached(node const& mnode, std::size_t& from);
+    void str_keep(node const& mnode, std::size_t from);
+    bool str_value(node const& mnode);
+
+    /**
+     * str_item writes one value reached through node::visit
+     * containers push a frame instead and set child to their first child
+     */
+    void str_item(node::nil_t, node const&, std::size_t, node const*&);
+    void str_item(bool val, node const&, std::size_t, node const*&);
+    void str_item(node::num_t val, node const&, std::size_t, node const*&);
+    void str_item(node::str_t const& val, node const&, std::size_t, node const*&);
+    void str_item(node::pak_t const& val, node const&, std::size_t, node const*&);
+    void str_item(node::arr_t const& val, node const& owner, std::size_t from, node const*& child);
+    void str_item(node::obj_t const& val, node const& owner, std::size_t from, node const*& child);
 };
 
+/**
+ * parse_doc parses a whole document, or an element of a top-level array
+ */
+inline node* json::parse_doc(std::string_view input, bool element)
+{
+    as_element = element;
+    begin = cur = input.data();
+    end = begin + input.size();
+    perr = error_code::non;
+
+    if constexpr (stats_enabled)
+        stat_parse_begin();
+
+    if (!root) {
+        root = std::make_unique<node>();
+        MINI_JSON_COUNT(count_alloc(sizeof(node)));
+    } else if (reclaim_by) {
+        reclaim_drop(reclaim_by, std::move(*root));
+    }
+
+    parsed = parse_value(*root) && parse_end();
+    values.clear();
+    keys.clear();
+
+    if constexpr (stats_enabled)
+        stat_parse_end();
+
+    if (parsed)
+        return root.get();
+
+    perr_pos = std::size_t(cur - begin);
+    if (reclaim_by)
+        reclaim_drop(reclaim_by, std::move(*root));
+    else
+        root->assign(nullptr);
+    return nullptr;
+}
+
 /**
  * parse_value take charge of distinguish the type of subnode
  * and dispatching the parsing tasks to other submethods
+ * nesting is driven by parse_stack instead of recursion:
+ * opening a container pushes it, parse_next pops it when closed
+ * the next value is always parsed into values.back()
  */
 inline bool json::parse_value(node& mnode)
 {
-    parse_ws();
-    switch (*context_it) {
-    case 'n':
-        return parse_literal(mnode);
+    parse_stack.clear();
+    values.clear();
+    keys.clear();
+    values.emplace_back();
+    proj_next = proj.root();
+    rule_next = rules.root();
+
+    // the root array holding an element is already too deep
+    if (as_element && max_depth == 0) {
+        perr = error_code::depth_exceeded;
+        return false;
+    }
 
-    case 't':
-        return parse_literal(mnode);
+    // an element takes the items rule of the root array
+    if (as_element) {
+        if (rule_next != schema::any && !rules.accepts(rule_next, '['))
+            return parse_violation();
+        rule_next = rules.items(rule_next);
+    }
 
-    case 'f':
-        return parse_literal(mnode);
+    bool open = false;
+    bool done = false;
 
-    case '\"':
-        return parse_string(mnode);
+    while (true) {
+        parse_ws();
 
-    case '[':
-        return parse_array(mnode);
+        // a member outside the projection leaves no slot behind
+        if (proj_next == projection::none) {
+            if (!parse_skip())
+                return false;
+            values.pop_back();
+            keys.pop_back();
+        } else {
+            auto st = cur;
+            if (rule_next != schema::any && !rules.accepts(rule_next, peek()))
+                return parse_violation();
 
-    case '{':
-        return parse_object(mnode);
+            switch (peek()) {
+            case 'n':
+            case 't':
+            case 'f':
+                if (!parse_literal(values.back()))
+                    return false;
+                break;
+
+            case '\"':
+                if (!parse_string(values.back()))
+                    return false;
+                break;
 
-    default:
-        return parse_number(mnode);
+            case '[':
+                if (!parse_array(open))
+                    return false;
+                if (open)
+                    continue;
+                break;
 
-    case '\0':
-        perr = error_code::expect_value;
+            case '{':
+                if (!parse_object(open))
+                    return false;
+                if (open)
+                    continue;
+                break;
+
+            default:
+                if (!parse_number(values.back()))
+                    return false;
+                break;
+
+            case '\0':
+                perr = error_code::expect_value;
+                return false;
+            }
+
+            // scalars and empty containers, open containers are checked once closed
+            if (rule_next != schema::any && !rules.check(rule_next, values.back(), 0)) {
+                cur = st;
+                return parse_violation();
+            }
+        }
+
+        if (!parse_next(done))
+            return false;
+
+        if (done) {
+            mnode = std::move(values.front());
+            return true;
+        }
+    }
+}
+
+/**
+ * parse_next runs after a value is complete
+ * it closes finished containers and opens the slot of the next sibling
+ * done is set once the root value is complete
+ */
+inline bool json::parse_next(bool& done)
+{
+    auto& it = cur;
+
+    while (!parse_stack.empty()) {
+        bool is_arr = parse_stack.back().is_arr;
+
+        parse_ws();
+        if (peek() == ',') {
+            ++it;
+            if (!is_arr)
+                return parse_member();
+
+            values.emplace_back();
+            proj_next = parse_stack.back().proj;
+            rule_next = rules.items(parse_stack.back().rule);
+            return true;
+        }
+
+        if (peek() == (is_arr ? ']' : '}')) {
+            ++it;
+            auto rule = parse_stack.back().rule;
+            auto seen = parse_stack.back().seen;
+            parse_close();
+            if (rule != schema::any && !rules.check(rule, values.back(), seen))
+                return parse_violation();
+            continue;
+        }
+
+        perr = error_code::miss_separator;
         return false;
     }
+
+    done = true;
+    return true;
+}
+
+/**
+ * parse_enter checks the depth of a container being opened
+ * empty containers count like others, though they never push a frame
+ * the depth limit keeps hostile input from exhausting memory
+ */
+inline bool json::parse_enter()
+{
+    // an element sits inside the root array, which is one level already
+    std::size_t depth = parse_stack.size() + as_element;
+    if (depth >= max_depth) {
+        perr = error_code::depth_exceeded;
+        return false;
+    }
+
+    MINI_JSON_COUNT(count_depth(depth + 1));
+    return true;
+}
+
+/**
+ * parse_push opens a non-empty container at values.back()
+ */
+inline void json::parse_push(bool is_arr)
+{
+    parse_stack.push_back({ values.size() - 1, keys.size(), proj_next, rule_next, 0, is_arr });
+}
+
+/**
+ * parse_close builds the innermost open container from its children
+ * the children are moved once into a container of the exact size
+ */
+inline void json::parse_close()
+{
+    auto top = parse_stack.back();
+    parse_stack.pop_back();
+
+    auto first = values.begin() + std::ptrdiff_t(top.slot + 1);
+    std::size_t size = std::size_t(values.end() - first);
+
+    if (top.is_arr && pack && parse_packable(first)) {
+        node::pak_t nums;
+        nums.reserve(size);
+        for (auto it = first; it != values.end(); ++it)
+            nums.push_back(std::get<node::num_t>(it->data));
+        MINI_JSON_COUNT(count_alloc(size * sizeof(double)));
+        values.erase(first, values.end());
+        values.back().assign(std::move(nums));
+        return;
+    }
+
+    if (top.is_arr) {
+        node::arr_t arr;
+        arr.reserve(size);
+        arr.insert(arr.end(), std::make_move_iterator(first), std::make_move_iterator(values.end()));
+        MINI_JSON_COUNT(count_alloc(size * sizeof(node)));
+        values.erase(first, values.end());
+        values.back().assign(std::move(arr));
+        return;
+    }
+
+    node::obj_t obj;
+    obj.reserve(size);
+    MINI_JSON_COUNT(count_alloc(obj.bucket_count() * sizeof(void*)));
+
+    auto key = keys.begin() + std::ptrdiff_t(top.key_base);
+    for (auto it = first; it != values.end(); ++it, ++key) {
+        // a repeated key keeps the first value
+        if constexpr (stats_enabled) {
+            auto before = obj.size();
+            obj.emplace(std::move(*key), std::move(*it));
+            if (obj.size() != before)
+                count_alloc(sizeof(node::obj_t::value_type) + sizeof(void*));
+        } else {
+            obj.emplace(std::move(*key), std::move(*it));
+        }
+    }
+
+    keys.erase(keys.begin() + std::ptrdiff_t(top.key_base), keys.end());
+    values.erase(first, values.end());
+    values.back().assign(std::move(obj));
+}
+
+/**
+ * parse_packable checks whether the elements from first are all numbers
+ */
+inline bool json::parse_packable(std::vector<node>::iterator first) const noexcept
+{
+    for (auto it = first; it != values.end(); ++it)
+        if (!std::holds_alternative<node::num_t>(it->data))
+            return false;
+    return true;
+}
+
+inline bool json::parse_violation()
+{
+    perr = error_code::schema_violation;
+    return false;
 }
 
 /**
@@ -152,8 +894,8 @@ inline bool json::parse_value(node& mnode)
  */
 inline void json::parse_ws()
 {
-    auto& it = context_it;
-    while (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r')
+    auto& it = cur;
+    while (it != end && (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r'))
         ++it;
 }
 
@@ -163,467 +905,877 @@ inline void json::parse_ws()
  */
 inline bool json::parse_literal(node& mnode)
 {
-    auto& it = context_it;
+    auto& it = cur;
+    std::string_view rest(it, end - it);
 
     // value is null
-    if (*(it + 1) == 'u' && *(it + 2) == 'l' && *(it + 3) == 'l') {
+    if (rest.substr(0, 4) == "null") {
         it += 4;
         mnode.assign(nullptr);
+        MINI_JSON_COUNT(count_node(node::data_k::null));
         return true;
     }
 
     // value is true
-    if (*(it + 1) == 'r' && *(it + 2) == 'u' && *(it + 3) == 'e') {
+    if (rest.substr(0, 4) == "true") {
         it += 4;
         mnode.assign(true);
+        MINI_JSON_COUNT(count_node(node::data_k::boolean));
+        return true;
+    }
+
+    // value is false
+    if (rest.substr(0, 5) == "false") {
+        it += 5;
+        mnode.assign(false);
+        MINI_JSON_COUNT(count_node(node::data_k::boolean));
+        return true;
+    }
+
+    // invalid value
+    perr = error_code::invalid_value;
+    return false;
+}
+
+/**
+ * parse_number take care of parsing the number literal
+ * the token is delimited by scan::number, the grammar validate and lazy
+ * mode use as well, then converted by from_chars within those bounds
+ */
+inline bool json::parse_number(node& mnode)
+{
+    auto& it = cur;
+    auto st = it;
+    if (!scan::number(it, end)) {
+        perr = error_code::invalid_value;
+        return false;
+    }
+
+    if (defer) {
+        node::raw_t val;
+        val.text.assign(st, it);
+        mnode.assign(std::move(val));
+        MINI_JSON_COUNT(count_node(node::data_k::number));
+        return true;
+    }
+
+    double num = 0;
+    auto [ed, ec] = std::from_chars(st, it, num);
+
+    // magnitudes beyond double keep the strtod behavior of inf and zero
+    if (ec == std::errc::result_out_of_range)
+        num = std::strtod(std::string(st, it).c_str(), nullptr);
+
+    mnode.assign(num);
+    MINI_JSON_COUNT(count_node(node::data_k::number));
+    return true;
+}
+
+/**
+ * parse_unicode is a submethod of parse_chars
+ * which converts \uXXXX to UTF-8, surrogate pairs become one code point
+ */
+template <bool Decode>
+inline bool json::parse_unicode(std::string& out)
+{
+    auto& it = cur;
+    std::uint32_t code = scan::unicode(it, end);
+    if (code > 0x10FFFF) {
+        perr = error_code::invalid_escape;
+        return false;
+    }
+
+    if constexpr (Decode) {
+        char tmp[4];
+        put(out, tmp, scan::encode(code, tmp));
+    }
+    return true;
+}
+
+/**
+ * parse_chars reads a quoted string into out
+ * runs of plain charactors are appended at once, escapes are decoded
+ * UTF-8 is checked within the same scan, so valid multi-byte
+ * sequences extend the current run instead of ending it
+ * without Decode the string is only checked and out is left alone
+ */
+template <bool Decode>
+inline bool json::parse_chars(std::string& out, bool& escaped)
+{
+    auto& it = ++cur;
+
+    while (true) {
+        auto st = it;
+        while (true) {
+            it = scan::plain(it, end);
+            if (it == end || static_cast<unsigned char>(*it) < 0x80)
+                break;
+            if (!scan::utf8(it, end)) {
+                perr = error_code::invalid_utf8;
+                return false;
+            }
+        }
+        if constexpr (Decode)
+            put(out, st, it - st);
+
+        if (it == end) {
+            perr = error_code::invalid_value;
+            return false;
+        }
+
+        if (*it == '\"') {
+            ++it;
+            return true;
+        }
+
+        if (*it != '\\') {
+            // control charactors must be escaped
+            perr = error_code::invalid_value;
+            return false;
+        }
+
+        escaped = true;
+        if (++it == end) {
+            perr = error_code::invalid_escape;
+            return false;
+        }
+
+        char ch = *it;
+        switch (ch) {
+        case '\"':
+        case '\\':
+        case '/':
+            break;
+        case 'b':
+            ch = '\b';
+            break;
+        case 'f':
+            ch = '\f';
+            break;
+        case 'n':
+            ch = '\n';
+            break;
+        case 'r':
+            ch = '\r';
+            break;
+        case 't':
+            ch = '\t';
+            break;
+        case 'u':
+            if (!parse_unicode<Decode>(out))
+                return false;
+            continue;
+        default:
+            perr = error_code::invalid_escape;
+            return false;
+        }
+
+        if constexpr (Decode)
+            put(out, &ch, 1);
+        ++it;
+    }
+}
+
+/**
+ * parse_string support parsing escape charactor and unicode
+ * the string is decoded into a scratch buffer kept warm between parses
+ * so the node only receives one allocation of the exact size
+ */
+inline bool json::parse_string(node& mnode)
+{
+    if (defer)
+        return parse_raw(mnode);
+
+    auto& rlt = scratch;
+    rlt.clear();
+
+    [[maybe_unused]] bool escaped = false;
+    if (!parse_chars(rlt, escaped))
+        return false;
+
+    mnode.assign(node::str_t(rlt));
+    MINI_JSON_COUNT(count_node(node::data_k::string));
+    MINI_JSON_COUNT(count_string(rlt.size()));
+    MINI_JSON_COUNT(++(escaped ? stat.strings_escaped : stat.strings_plain));
+    return true;
+}
+
+/**
+ * parse_raw is parse_string of lazy parsers
+ * the string is only checked, plain ones are copied from the input once
+ * and escaped ones keep their source text until they are read
+ */
+inline bool json::parse_raw(node& mnode)
+{
+    auto st = cur + 1;
+    bool escaped = false;
+    if (!parse_chars<false>(scratch, escaped))
+        return false;
+
+    std::size_t len = std::size_t(cur - 1 - st);
+    if (escaped) {
+        node::raw_t val;
+        val.text.assign(st, len);
+        val.is_str = true;
+        val.escaped = true;
+        mnode.assign(std::move(val));
+    } else {
+        mnode.assign(node::str_t(st, len));
+    }
+
+    MINI_JSON_COUNT(count_node(node::data_k::string));
+    MINI_JSON_COUNT(count_string(len));
+    MINI_JSON_COUNT(++(escaped ? stat.strings_escaped : stat.strings_plain));
+    return true;
+}
+
+/**
+ * parse_array take charge of parsing array datastruture
+ * which use vector as default container
+ * open is set when the array has elements to parse
+ */
+inline bool json::parse_array(bool& open)
+{
+    auto& it = ++cur;
+    parse_ws();
+    MINI_JSON_COUNT(count_node(node::data_k::array));
+    if (!parse_enter())
+        return false;
+
+    if (peek() == ']') {
+        ++it;
+        values.back().assign(node::arr_t());
+        open = false;
         return true;
     }
 
-    // value is false
-    if (*(it + 1) == 'a' && *(it + 2) == 'l' && *(it + 3) == 's' && *(it + 4) == 'e') {
-        it += 5;
-        mnode.assign(false);
+    parse_push(true);
+    values.emplace_back();
+    rule_next = rules.items(rule_next);
+    open = true;
+    return true;
+}
+
+/**
+ * parse_key is a submethod of parse_object
+ * object use a string as its key
+ */
+inline bool json::parse_key(std::string& key)
+{
+    if (peek() != '\"') {
+        perr = error_code::invalid_key;
+        return false;
+    }
+
+    bool escaped = false;
+    key.clear();
+    return parse_chars(key, escaped);
+}
+
+/**
+ * parse_object take charge of parsing object datastructure
+ * object node use unordered_map as its default container
+ * open is set when the object has members to parse
+ */
+inline bool json::parse_object(bool& open)
+{
+    auto& it = ++cur;
+    parse_ws();
+    MINI_JSON_COUNT(count_node(node::data_k::object));
+    if (!parse_enter())
+        return false;
+
+    if (peek() == '}') {
+        ++it;
+        values.back().assign(node::obj_t());
+        open = false;
         return true;
     }
 
-    // invalid value
-    perr = error_code::invalid_value;
-    return false;
+    parse_push(false);
+    open = true;
+    return parse_member();
 }
 
 /**
- * parse_number take care of parsing the number literal
- * which is supported by standard function :)
+ * parse_member reads a key and the colon after it
+ * then opens the slot of its value
  */
-inline bool json::parse_number(node& mnode)
+inline bool json::parse_member()
 {
-    auto& it = context_it;
-    char *st = &*it, *ed = st;
+    auto& it = cur;
+    auto& key = key_scratch;
 
-    double num = static_cast<double>(std::strtod(st, &ed));
-    if (st == ed) {
-        perr = error_code::invalid_value;
+    parse_ws();
+    auto st = it;
+    if (!parse_key(key))
+        return false;
+
+    parse_ws();
+    if (peek() == ':') {
+        ++it;
+    } else {
+        perr = error_code::miss_separator;
         return false;
     }
 
-    it += ed - st;
-    mnode.assign(num);
+    auto& top = parse_stack.back();
+    proj_next = top.proj == projection::all ? top.proj : proj.member(top.proj, key);
+
+    // members may be forbidden by the schema or ignored like projected ones
+    if (top.rule != schema::any) {
+        std::uint64_t bit = 0;
+        rule_next = rules.member(top.rule, key, bit);
+        top.seen |= bit;
+        if (rule_next == schema::reject) {
+            it = st;
+            return parse_violation();
+        }
+        if (rule_next == schema::skip)
+            proj_next = projection::none;
+    } else {
+        rule_next = schema::any;
+    }
+
+    // copied from the warm scratch buffer with one exact-size allocation
+    // skipped members get an empty slot, which parse_value drops again
+    if (proj_next == projection::none) {
+        keys.emplace_back();
+        values.emplace_back();
+        return true;
+    }
+
+    keys.emplace_back(key);
+    values.emplace_back();
+    MINI_JSON_COUNT(count_string(key.size()));
     return true;
 }
 
 /**
- * parse_unicode is a submethod of parse_string and parse_key
- * which only support to convert the unicode to UTF-8
+ * parse_skip passes over a value outside the projection without building it
+ * strings are crossed a word at a time and brackets are only counted
  */
-inline bool json::parse_unicode(std::string& out)
+inline bool json::parse_skip()
 {
-    auto& it = ++context_it;
-    // check whether the first character is space, space is invalid
-    if (std::isspace(*it)) {
-        perr = error_code::invalid_escape;
-        return false;
+    auto& it = cur;
+    auto st = it;
+    std::size_t depth = 0;
+    MINI_JSON_COUNT(++stat.values_skipped);
+
+    while (it != end) {
+        char ch = *it;
+        if (ch == '\"') {
+            while (true) {
+                it = scan::quote(it + 1, end);
+                if (it == end) {
+                    perr = error_code::invalid_value;
+                    return false;
+                }
+                if (*it == '\"')
+                    break;
+                // the escaped charactor is skipped by the next scan
+                if (++it == end) {
+                    perr = error_code::invalid_escape;
+                    return false;
+                }
+            }
+        } else if (ch == '[' || ch == '{') {
+            ++depth;
+        } else if (ch == ']' || ch == '}') {
+            if (depth == 0)
+                break;
+            --depth;
+        } else if (ch == ',' && depth == 0) {
+            break;
+        }
+
+        ++it;
+        if (depth == 0 && (ch == '\"' || ch == ']' || ch == '}'))
+            return true;
     }
 
-    uint32_t code = 0;
-    char* end = nullptr;
-    code = (uint32_t)std::strtol(&*it, &end, 16);
-    // check if convertion is success
-    if (end != &*it + 4) {
-        perr = error_code::invalid_escape;
+    if (it == st) {
+        perr = error_code::expect_value;
         return false;
     }
 
-    char tmp[4] = { 0 };
-    std::size_t len = 0;
-    if (code <= 0x7F) {
-        tmp[0] = char(code & 0xFF);
-        len = 1;
-    } else if (code <= 0x7FF) {
-        tmp[0] = char(0xC0 | ((code >> 6) & 0xFF));
-        tmp[1] = char(0x80 | (code & 0x3F));
-        len = 2;
-    } else if (code <= 0xFFFF) {
-        tmp[0] = char(0xE0 | ((code >> 12) & 0xFF));
-        tmp[1] = char(0x80 | ((code >> 6) & 0x3F));
-        tmp[2] = char(0x80 | (code & 0x3F));
-        len = 3;
-    } else if (code <= 0x10FFFF) {
-        tmp[0] = char(0xF0 | ((code >> 18) & 0xFF));
-        tmp[1] = char(0x80 | ((code >> 12) & 0x3F));
-        tmp[2] = char(0x80 | ((code >> 6) & 0x3F));
-        tmp[3] = char(0x80 | (code & 0x3F));
-        len = 4;
-    } else {
-        perr = error_code::invalid_escape;
+    if (depth != 0) {
+        perr = error_code::invalid_value;
         return false;
     }
-
-    out.append(tmp, len);
-    it += 3;
     return true;
 }
 
 /**
- * parse_string support parsing escape charactor and unicode
- * but it only support to parse to UTF-8 charactors
+ * str_value is the interface to stringify root node
+ * containers are walked with str_stack instead of recursion
+ * each frame remembers the position of the member or element being written
  */
-inline bool json::parse_string(node& mnode)
+inline bool json::str_value(node const& mnode)
 {
-    auto& it = context_it;
-    std::string rlt;
+    auto& stk = str_stack;
+    stk.clear();
+    node const* cnode = &mnode;
 
     while (true) {
-        switch (*++it) {
-        case '\"': {
-            mnode.assign(std::move(rlt));
-            ++it;
-            return true;
-        }
-
-        case '\0':
-            perr = error_code::invalid_value;
-            return false;
-
-        case '\\':
-            switch (*++it) {
-            case '\"':
-                rlt.append("\"");
-                break;
-            case '\\':
-                rlt.append("\\");
-                break;
-            case '/':
-                rlt.append("/");
-                break;
-            case 'b':
-                rlt.append("\b");
-                break;
-            case 'f':
-                rlt.append("\f");
-                break;
-            case 'n':
-                rlt.append("\n");
-                break;
-            case 'r':
-                rlt.append("\r");
-                break;
-            case 't':
-                rlt.append("\t");
-                break;
-            case 'u': {
-                std::string ustr;
-                if (!parse_unicode(ustr))
-                    return false;
-                rlt.append(ustr);
-                break;
+        std::size_t from = std::string::npos;
+        node const* child = nullptr;
+        if (!str_cached(*cnode, from)) {
+            node const& owner = *cnode;
+            if (auto const* lazy = std::get_if<node::raw_t>(&owner.resolve().data); lazy)
+                str_raw(*lazy);
+            else
+                owner.visit([&](auto const& val) { str_item(val, owner, from, child); });
+            if (child) {
+                cnode = child;
+                continue;
             }
-            default:
-                perr = error_code::invalid_escape;
-                return false;
+        }
+        str_keep(*cnode, from);
+
+        // the value is written, move to the next sibling or close containers
+        while (true) {
+            if (stk.empty())
+                return true;
+
+            auto& top = stk.back();
+            if (top.cont->type() == node::data_k::array) {
+                auto& arr = top.cont->get<node::arr_t>();
+                if (++top.index < arr.size()) {
+                    string->append(", ");
+                    cnode = &arr[top.index];
+                    break;
+                }
+                string->append("]");
+            } else {
+                auto& obj = top.cont->get<node::obj_t>();
+                if (++top.member != obj.end()) {
+                    string->append(", \"");
+                    str_string(top.member->first);
+                    string->append("\": ");
+                    cnode = &top.member->second;
+                    break;
+                }
+                string->append("}");
             }
-            break;
-
-        default:
-            rlt.append(&*it, 1);
-            break;
+            str_keep(*top.cont, top.from);
+            stk.pop_back();
         }
     }
 }
 
 /**
- * parse_array take charge of parsing array datastruture
- * which use vector as default container
+ * str_cached copies the cached text of a frozen node
+ * otherwise from is set to where its text starts if it should be kept
  */
-inline bool json::parse_array(node& mnode)
+inline bool json::str_cached(node const& mnode, std::size_t& from)
 {
-    auto& it = ++context_it;
-    parse_ws();
-    mnode.assign(node::arr_t());
+    if (!cache_min || !mnode.frozen())
+        return false;
 
-    if (*it == ']') {
-        ++it;
+    auto const& holder = std::get<node::shr_t>(mnode.data);
+    if (auto text = holder->text.load()) {
+        str_run(text->data(), text->data() + text->size());
+        MINI_JSON_COUNT(++stat.fragments_reused);
+        MINI_JSON_COUNT(stat.bytes_reused += text->size());
+        if (gather_min)
+            pins.push_back(std::move(text));
         return true;
     }
 
-    node cnode;
-    auto& arr = mnode.get<node::arr_t>();
-
-    while (true) {
-        if (!parse_value(cnode))
-            return false;
+    from = string->size();
+    return false;
+}
 
-        arr.push_back(std::move(cnode));
+/**
+ * str_keep stores the text written since from into the frozen node
+ */
+inline void json::str_keep(node const& mnode, std::size_t from)
+{
+    if (from == std::string::npos || string->size() - from < cache_min)
+        return;
 
-        parse_ws();
-        if (*it == ']') {
-            ++it;
-            return true;
-        }
+    // part of the text was referenced by str_gather and is not in string
+    if (!cuts.empty() && cuts.back().offset >= from)
+        return;
 
-        if (*it == ',')
-            ++it;
-    }
+    auto const& holder = std::get<node::shr_t>(mnode.data);
+    holder->text.store(std::make_shared<std::string const>(*string, from));
 }
 
 /**
- * parse_key is a submethod of parse_object
- * object use a string as its key
+ * because of escape charactors
+ * node of string type need to be sepcially handled
+ * runs without escapes are appended at once, straight into the output
  */
-inline bool json::parse_key(std::string& key)
+inline void json::str_string(std::string_view src)
 {
-    auto& it = context_it;
+    char const* it = src.data();
+    char const* end = it + src.size();
 
     while (true) {
-        switch (*++it) {
-        case '\"': {
-            ++it;
-            return true;
-        }
-
-        case '\0':
-            perr = error_code::invalid_value;
-            return false;
-
-        case '\\':
-            switch (*++it) {
-            case '\"':
-                key.append("\"");
-                break;
-            case '\\':
-                key.append("\\");
-                break;
-            case '/':
-                key.append("/");
-                break;
-            case 'b':
-                key.append("\b");
-                break;
-            case 'f':
-                key.append("\f");
-                break;
-            case 'n':
-                key.append("\n");
-                break;
-            case 'r':
-                key.append("\r");
-                break;
-            case 't':
-                key.append("\t");
-                break;
-            case 'u': {
-                std::string ustr;
-                if (!parse_unicode(ustr))
-                    return false;
-                key.append(ustr);
-                break;
-            }
-            default:
-                perr = error_code::invalid_escape;
-                return false;
-            }
-            break;
-
-        default:
-            key.append(&*it, 1);
-            break;
-        }
+        auto st = it;
+        it = scan::escaped(it, end);
+        str_run(st, it);
+        if (it == end)
+            return;
+
+        char esc[6];
+        string->append(esc, scan::escape(*it++, esc));
     }
 }
 
 /**
- * parse_object take charge of parsing object datastructure
- * object node use unordered_map as its default container
+ * str_run appends a run which needs no escaping
+ * str_gather refers to long runs in place instead
  */
-inline bool json::parse_object(node& mnode)
+inline void json::str_run(char const* first, char const* last)
 {
-    auto& it = ++context_it;
-    parse_ws();
-    mnode.assign(node::obj_t());
+    if (gather_min && std::size_t(last - first) >= gather_min)
+        cuts.push_back({ string->size(), std::string_view(first, std::size_t(last - first)) });
+    else
+        string->append(first, last);
+}
 
-    if (*it == '}') {
-        ++it;
-        return true;
+/**
+ * raw values are written from their source text without decoding them
+ * strings which were decoded in place are escaped again
+ */
+inline void json::str_raw(node::raw_t const& val)
+{
+    if (!val.is_str) {
+        string->append(val.text);
+        return;
     }
 
-    auto& obj = mnode.get<node::obj_t>();
-    node cnode;
-    std::string key;
+    string->push_back('\"');
+    if (val.ready)
+        str_string(val.text);
+    else
+        str_run(val.text.data(), val.text.data() + val.text.size());
+    string->push_back('\"');
+}
 
-    while (true) {
-        parse_ws();
-        if (!parse_key(key))
-            return false;
+/**
+ * str_number writes the format of std::to_string ("%f") into buf of 512 bytes,
+ * through to_chars which is exact like printf and skips the locale
+ */
+inline std::size_t json::str_number(node::num_t val, char* buf) noexcept
+{
+    auto ret = std::to_chars(buf, buf + 512, val, std::chars_format::fixed, 6);
+    return std::size_t(ret.ptr - buf);
+}
 
-        parse_ws();
-        if (*it == ':') {
-            ++it;
-        } else {
-            perr = error_code::miss_separator;
-            return false;
-        }
+/**
+ * str_size adds up the length of every value, the order does not matter
+ * so the walk is a plain stack of nodes
+ */
+inline std::size_t json::str_size()
+{
+    if (!parsed)
+        return 0;
 
-        if (!parse_value(cnode))
-            return false;
+    char buf[512];
+    std::size_t ret = 0;
+    auto& stk = size_stack;
+    stk.clear();
+    stk.push_back(root.get());
+
+    auto quoted = [](std::string const& str) {
+        return scan::escaped_size(str.data(), str.data() + str.size()) + 2;
+    };
 
-        obj.emplace(std::move(key), std::move(cnode));
+    while (!stk.empty()) {
+        node const& cnode = *stk.back();
+        stk.pop_back();
 
-        parse_ws();
-        if (*it == '}') {
-            ++it;
-            return true;
+        if (cnode.frozen())
+            if (auto text = std::get<node::shr_t>(cnode.data)->text.load()) {
+                ret += text->size();
+                continue;
+            }
+
+        if (auto const* lazy = std::get_if<node::raw_t>(&cnode.resolve().data); lazy) {
+            std::size_t len = lazy->text.size();
+            ret += !lazy->is_str ? len : lazy->ready ? quoted(lazy->text) : len + 2;
+            continue;
         }
 
-        if (*it == ',')
-            ++it;
+        cnode.visit([&](auto const& val) {
+            using T = std::decay_t<decltype(val)>;
+            if constexpr (std::is_same_v<T, node::nil_t>) {
+                ret += 4;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                ret += val ? 4 : 5;
+            } else if constexpr (std::is_same_v<T, node::num_t>) {
+                ret += str_number(val, buf);
+            } else if constexpr (std::is_same_v<T, node::str_t>) {
+                ret += quoted(val);
+            } else {
+                // brackets and ", " between elements
+                ret += 2 + (val.empty() ? 0 : 2 * (val.size() - 1));
+                if constexpr (std::is_same_v<T, node::pak_t>) {
+                    for (auto num : val)
+                        ret += str_number(num, buf);
+                } else if constexpr (std::is_same_v<T, node::arr_t>) {
+                    for (auto const& sub : val)
+                        stk.push_back(&sub);
+                } else {
+                    // quotes and ": " around every key
+                    for (auto const& [key, sub] : val) {
+                        ret += quoted(key) + 2;
+                        stk.push_back(&sub);
+                    }
+                }
+            }
+        });
     }
+    return ret;
 }
 
 /**
- * str_value is the interface to stringify root node
+ * the interface of stringing scalar nodes
  */
-inline bool json::str_value(node& mnode)
+inline void json::str_item(node::nil_t, node const&, std::size_t, node const*&)
 {
-    switch (mnode.type()) {
-    case node::data_k::array:
-        return str_array(mnode);
-
-    case node::data_k::object:
-        return str_object(mnode);
-
-    default:
-        return str_literal(mnode);
-    }
-    return false;
+    string->append("null");
 }
 
-/**
- * because of escape charactors
- * node of string type need to be sepcially handled
- */
-inline std::string json::str_string(std::string_view src)
+inline void json::str_item(bool val, node const&, std::size_t, node const*&)
 {
-    std::string ret;
+    string->append(val ? "true" : "false");
+}
 
-    for (auto it = src.begin(); it != src.end(); ++it)
-        switch (*it) {
-        case '\"':
-            ret.append("\\\"");
-            break;
+inline void json::str_item(node::num_t val, node const&, std::size_t, node const*&)
+{
+    char buf[512];
+    string->append(buf, str_number(val, buf));
+}
 
-        default:
-            ret.append(&*it, 1);
-            break;
-        }
+inline void json::str_item(node::str_t const& val, node const&, std::size_t, node const*&)
+{
+    string->push_back('\"');
+    str_string(val);
+    string->push_back('\"');
+}
 
-    return ret;
+inline void json::str_item(node::pak_t const& val, node const&, std::size_t, node const*&)
+{
+    // one tight loop without dispatching on every element
+    char buf[512];
+    string->push_back('[');
+    for (std::size_t i = 0; i < val.size(); i++) {
+        if (i)
+            string->append(", ");
+        string->append(buf, str_number(val[i], buf));
+    }
+    string->push_back(']');
 }
 
 /**
- * the interface of stringing literal node
+ * non-empty containers are opened here and closed by str_value
  */
-inline bool json::str_literal(node& mnode)
+inline void json::str_item(node::arr_t const& val, node const& owner, std::size_t from, node const*& child)
 {
-    switch (mnode.type()) {
-    case node::data_k::null:
-        string->append("null");
-        break;
-
-    case node::data_k::boolean:
-        string->append(mnode.get<bool>() ? "true" : "false");
-        break;
-
-    case node::data_k::number: {
-        auto conv = std::to_string(mnode.get<node::num_t>());
-        string->append(std::string(conv.begin(), conv.end()));
-        break;
+    if (val.empty()) {
+        string->append("[]");
+        return;
     }
 
-    case node::data_k::string:
-        string->append("\"")
-            .append(str_string(mnode.get<node::str_t>()))
-            .append("\"");
-        break;
+    string->append("[");
+    str_stack.push_back({ &owner, 0, {}, from });
+    child = &val.front();
+}
 
-    default:
-        return false;
+inline void json::str_item(node::obj_t const& val, node const& owner, std::size_t from, node const*& child)
+{
+    if (val.empty()) {
+        string->append("{}");
+        return;
     }
 
-    return true;
+    auto member = val.begin();
+    string->append("{\"");
+    str_string(member->first);
+    string->append("\": ");
+    str_stack.push_back({ &owner, 0, member, from });
+    child = &member->second;
 }
 
 /**
- * stringing node of array type
+ * validate walks the input once as a state machine
+ * string contents are skipped in words of 8 bytes by scan::plain
  */
-inline bool json::str_array(node& mnode)
+template <std::size_t MaxDepth>
+inline json::validation json::validate(std::string_view input) noexcept
 {
-    string->append("[");
-    auto& arr = mnode.get<node::arr_t>();
+    char const* const st = input.data();
+    char const* const ed = st + input.size();
+    char const* it = st;
 
-    bool sts = false;
-    for (auto it = arr.begin(); it != arr.end();) {
+    // bit set when the container at that depth is an object
+    std::uint64_t objects[(MaxDepth + 63) / 64] = {};
+    std::size_t depth = 0;
 
-        switch (it->type()) {
-        case node::data_k::array:
-            sts = str_array(*it);
-            break;
+    auto fail = [&](error_code code) {
+        return validation { code, std::size_t(it - st) };
+    };
 
-        case node::data_k::object:
-            sts = str_object(*it);
-            break;
+    auto is_object = [&](std::size_t level) {
+        return (objects[level / 64] >> (level % 64)) & 1;
+    };
 
-        default:
-            sts = str_literal(*it);
-            break;
+    // it points to the opening quote, stops after the closing one
+    auto string = [&]() -> error_code {
+        ++it;
+        while (true) {
+            it = scan::plain(it, ed);
+            if (it == ed)
+                return error_code::invalid_value;
+
+            auto ch = static_cast<unsigned char>(*it);
+            if (ch == '\"') {
+                ++it;
+                return error_code::non;
+            }
+
+            if (ch == '\\') {
+                if (++it == ed)
+                    return error_code::invalid_escape;
+                switch (*it) {
+                case '\"':
+                case '\\':
+                case '/':
+                case 'b':
+                case 'f':
+                case 'n':
+                case 'r':
+                case 't':
+                    ++it;
+                    break;
+                case 'u':
+                    if (scan::unicode(it, ed) > 0x10FFFF)
+                        return error_code::invalid_escape;
+                    break;
+                default:
+                    return error_code::invalid_escape;
+                }
+                continue;
+            }
+
+            if (ch < 0x20)
+                return error_code::invalid_value;
+
+            if (!scan::utf8(it, ed))
+                return error_code::invalid_utf8;
         }
+    };
+
+    // a key and its colon, it points to the first byte after the separator
+    auto member = [&]() -> error_code {
+        it = scan::ws(it, ed);
+        if (it == ed || *it != '\"')
+            return error_code::invalid_key;
+        if (auto code = string(); code != error_code::non)
+            return code;
+        it = scan::ws(it, ed);
+        if (it == ed || *it != ':')
+            return error_code::miss_separator;
+        ++it;
+        return error_code::non;
+    };
 
-        if (!sts)
+    auto literal = [&](std::string_view word) {
+        if (std::size_t(ed - it) < word.size() || std::string_view(it, word.size()) != word)
             return false;
+        it += word.size();
+        return true;
+    };
 
-        if (++it != arr.end())
-            string->append(", ");
-    }
+    while (true) {
+        // expecting a value
+        it = scan::ws(it, ed);
+        if (it == ed)
+            return fail(error_code::expect_value);
 
-    string->append("]");
-    return true;
-}
+        switch (*it) {
+        case '[':
+        case '{': {
+            bool obj = *it == '{';
+            it = scan::ws(it + 1, ed);
+            if (depth == MaxDepth)
+                return fail(error_code::depth_exceeded);
+
+            if (it != ed && *it == (obj ? '}' : ']')) {
+                ++it;
+                break;
+            }
 
-/**
- * stringing node of object node
- */
-inline bool json::str_object(node& mnode)
-{
-    string->append("{");
-    auto& map = mnode.get<node::obj_t>();
+            auto bit = std::uint64_t(1) << (depth % 64);
+            objects[depth / 64] = obj ? objects[depth / 64] | bit : objects[depth / 64] & ~bit;
+            ++depth;
+
+            if (obj)
+                if (auto code = member(); code != error_code::non)
+                    return fail(code);
+            continue;
+        }
 
-    bool sts = false;
-    for (auto it = map.begin(); it != map.end();) {
-        string->append("\"")
-            .append(str_string(it->first))
-            .append("\": ");
+        case '\"':
+            if (auto code = string(); code != error_code::non)
+                return fail(code);
+            break;
+
+        case 't':
+            if (!literal("true"))
+                return fail(error_code::invalid_value);
+            break;
 
-        switch (it->second.type()) {
-        case node::data_k::array:
-            sts = str_array(it->second);
+        case 'f':
+            if (!literal("false"))
+                return fail(error_code::invalid_value);
             break;
 
-        case node::data_k::object:
-            sts = str_object(it->second);
+        case 'n':
+            if (!literal("null"))
+                return fail(error_code::invalid_value);
             break;
 
         default:
-            sts = str_literal(it->second);
+            if (!scan::number(it, ed))
+                return fail(error_code::invalid_value);
             break;
         }
 
-        if (!sts)
-            return false;
+        // a value is complete, close containers until a comma opens the next one
+        while (true) {
+            it = scan::ws(it, ed);
+            if (depth == 0) {
+                if (it != ed)
+                    return fail(error_code::root_singular);
+                return validation {};
+            }
 
-        if (++it != map.end())
-            string->append(", ");
-    }
+            bool obj = is_object(depth - 1);
+            if (it != ed && *it == ',') {
+                ++it;
+                if (obj)
+                    if (auto code = member(); code != error_code::non)
+                        return fail(code);
+                break;
+            }
 
-    string->append("}");
-    return true;
+            if (it != ed && *it == (obj ? '}' : ']')) {
+                ++it;
+                --depth;
+                continue;
+            }
+
+            return fail(error_code::miss_separator);
+        }
+    }
 }
 
-}; // namespace mini_json
\ No newline at end of file
+}; // namespace mini_json
+
+#undef MINI_JSON_COUNT
\ No newline at end of file
@@ -1,15 +1,36 @@
 #pragma once
 #include "../mini_mpf/type_umap.hpp"
 #include "exception.hpp"
+#include "scan.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <string>
+#include <system_error>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
 
+/**
+ * MINI_JSON_NOINLINE keeps a cold path out of its callers,
+ * so the inline fast path around it stays small
+ */
+#ifdef _MSC_VER
+#define MINI_JSON_NOINLINE __declspec(noinline)
+#else
+#define MINI_JSON_NOINLINE __attribute__((noinline))
+#endif
+
 namespace mini_json {
 
 class node {
@@ -24,15 +45,61 @@ private:
     template <typename T1, typename T2>
     constexpr static bool is_same = std::is_same_v<T1, T2>;
 
+    /**
+     * share holds the immutable value of a frozen subtree
+     * which is reference counted by every node copied from it
+     */
+    struct share;
+
     using obj_t = std::unordered_map<std::string, node>;
     using arr_t = std::vector<node>;
+    using shr_t = std::shared_ptr<share const>;
+    using pak_t = std::vector<double>;
     using nil_t = std::nullptr_t;
     using str_t = std::string;
     using num_t = double;
 
+    /**
+     * raw keeps the source text of a number or string parsed lazily,
+     * see json::lazy, and decodes it on first access
+     * numbers cache their value and keep the text for exact output,
+     * escaped strings are decoded in place
+     * decoding a const node is not thread-safe, freeze decodes the whole tree
+     */
+    struct raw {
+        mutable std::string text;
+        mutable num_t num = 0;
+        bool is_str = false;
+        // text still holds escapes
+        mutable bool escaped = false;
+        // num is cached, or text was unescaped and needs escaping on output
+        mutable bool ready = false;
+
+        num_t const& number() const;
+        str_t const& string() const;
+
+        template <typename T>
+        T const& value() const
+        {
+            if constexpr (is_same<num_t, T>)
+                return number();
+            else
+                return string();
+        }
+    };
+
+    using raw_t = raw;
+
 public:
     friend class json;
 
+    /**
+     * shared marks a frozen node internally
+     * type() reports the kind of the shared value instead
+     * packed is an array of numbers stored as std::vector<double>,
+     * see json::pack_numbers
+     * raw marks a lazily parsed number or string, type() reports which
+     */
     enum class data_k {
         null,
         array,
@@ -40,6 +107,9 @@ public:
         string,
         number,
         boolean,
+        shared,
+        packed,
+        raw,
     };
 
     using data_t = mini_mpf::type_umap<data_k,
@@ -48,17 +118,127 @@ public:
         obj_t,
         str_t,
         num_t,
-        bool>;
+        bool,
+        shr_t,
+        pak_t,
+        raw_t>;
 
 private:
     data_t::forward<std::variant> data;
 
-    data_k type()
+    // the node which holds the value, frozen nodes forward to their share
+    node const& resolve() const noexcept;
+
+    // give this node its own copy of a frozen value before mutation
+    void unshare();
+
+    // turn a packed array into an array of nodes
+    void unpack();
+
+    // replace a raw value by the value it decodes to
+    void decode();
+
+    // pointer to the value of this resolved node or nullptr, raw values are decoded
+    template <typename T>
+    T const* value_if() const;
+
+    // entries of the jump table of visit, one per alternative
+    template <typename Fn>
+    struct visitor {
+        using result = std::invoke_result_t<Fn&, nil_t const&>;
+
+        template <typename T, data_k Key>
+        struct entry {
+            static result call(Fn& fn, node const& src);
+            constexpr static auto value = &call;
+        };
+    };
+
+    // structural hash of each alternative, packed arrays hash like arrays of numbers
+    static std::size_t hash_of(nil_t) noexcept;
+    static std::size_t hash_of(bool val) noexcept;
+    static std::size_t hash_of(num_t val) noexcept;
+    static std::size_t hash_of(str_t const& val) noexcept;
+    static std::size_t hash_of(arr_t const& val);
+    static std::size_t hash_of(obj_t const& val);
+    static std::size_t hash_of(pak_t const& val) noexcept;
+
+    // equality of a value and a resolved node, arrays equal packed arrays
+    template <typename T>
+    static bool equal(T const& val, node const& other);
+
+    template <typename Lhs, typename Rhs>
+    static bool equal_seq(Lhs const& lhs, Rhs const& rhs);
+
+    template <typename Lhs, typename Rhs>
+    static bool equal_elem(Lhs const& lhs, Rhs const& rhs);
+
+public:
+    data_k type() const noexcept
     {
-        return static_cast<data_k>(data.index());
+        auto const& src = resolve().data;
+        if (auto const* lazy = std::get_if<raw_t>(&src); lazy)
+            return lazy->is_str ? data_k::string : data_k::number;
+        return static_cast<data_k>(src.index());
     }
 
-public:
+    /**
+     * frozen nodes share their value with every copy
+     * copying them is O(1) and they are safe to read from many threads
+     */
+    bool frozen() const noexcept
+    {
+        return std::holds_alternative<shr_t>(data);
+    }
+
+    /**
+     * freeze turns strings and containers of the whole tree into shared values
+     * a later mutable access clones only the path from this node to the target
+     * whose siblings stay shared, so snapshots never observe the mutation
+     */
+    void freeze();
+
+    /**
+     * pack stores a non-empty array of plain numbers as a packed array,
+     * the rule json::pack_numbers applies while parsing
+     * returns false and leaves other values untouched
+     */
+    bool pack();
+
+    /**
+     * heap bytes owned by a tree, the node itself excluded
+     * shared values are counted once however often they are referenced
+     * hash map entries are estimated from the size of their elements
+     */
+    struct footprint {
+        // elements of arrays and packed arrays in use
+        std::size_t elements = 0;
+        // capacity of arrays, packed arrays and strings beyond their size
+        std::size_t slack = 0;
+        // entries and bucket arrays of objects
+        std::size_t members = 0;
+        std::size_t buckets = 0;
+        // heap blocks of strings, keys and raw values
+        std::size_t strings = 0;
+        // shares of frozen values
+        std::size_t shared = 0;
+
+        std::size_t total() const noexcept
+        {
+            return elements + slack + members + buckets + strings + shared;
+        }
+    };
+
+    footprint memory_usage() const;
+
+    /**
+     * compact rebuilds the tree into containers and strings of exact capacity
+     * allocated in depth-first order, so a traversal walks memory forward
+     * frozen subtrees are shared with other trees and are left as they are
+     * then_freeze freezes the compacted tree
+     */
+    void compact(bool then_freeze = false);
+
     template <typename T>
     constexpr void assign(T&& elem)
     {
@@ -84,51 +264,96 @@ public:
         }
     }
 
+    /**
+     * a mutable get is treated as a mutation of frozen nodes
+     * which unshares this node (but not its children)
+     * getting an array of nodes from a packed array unpacks it
+     */
     template <typename T>
     constexpr T& get()
     {
         using Pure = std::decay_t<T>;
         static_assert(data_t::find_if<Pure>(), "mini_json::node::get : invalid type");
 
+        if constexpr (is_same<arr_t, Pure>)
+            if (std::holds_alternative<pak_t>(resolve().data))
+                unpack();
+
+        if constexpr (is_same<num_t, Pure> || is_same<str_t, Pure>)
+            if (std::holds_alternative<raw_t>(resolve().data))
+                decode();
+
+        if (frozen() && std::holds_alternative<Pure>(resolve().data))
+            unshare();
+
         if (T* got = std::get_if<Pure>(&data); got)
             return *got;
 
         throw bad_get();
     }
 
+    /**
+     * a const get never converts, so an array of nodes is not found
+     * in a packed array, read it as std::vector<double> instead
+     */
     template <typename T>
     constexpr T const& get() const
     {
         using Pure = std::decay_t<T>;
         static_assert(data_t::find_if<Pure>(), "mini_json::node::get : invalid type");
 
-        if (T const* got = std::get_if<Pure>(&data); got)
+        if (T const* got = resolve().value_if<Pure>(); got)
             return *got;
 
         throw bad_get();
     }
 
-#define CHECK_AND_HANDLE(type)                               \
-    if constexpr (convable<T, type>)                         \
-        if (auto const* got = std::get_if<type>(&data); got) \
-    return Pure(*got)
+    /**
+     * visit calls fn with the value held by this node, a frozen node passes
+     * its shared value and a raw one its decoded value,
+     * so fn is called for every alternative except shr_t and raw_t
+     * dispatch is a single indirect call through a table generated from data_t
+     */
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) const;
 
     template <typename T>
     T as() const
     {
         using Pure = std::decay_t<T>;
 
-        CHECK_AND_HANDLE(nil_t);
-        CHECK_AND_HANDLE(arr_t);
-        CHECK_AND_HANDLE(obj_t);
-        CHECK_AND_HANDLE(str_t);
-        CHECK_AND_HANDLE(num_t);
-        CHECK_AND_HANDLE(bool);
-
-        throw bad_as();
+        return visit([](auto const& val) -> Pure {
+            using Src = std::decay_t<decltype(val)>;
+
+            // null is never turned into a string through its char pointer
+            if constexpr (convable<T, Src> && !(is_same<nil_t, Src> && convable<T, char const*>))
+                return Pure(val);
+            // packed arrays convert like arrays of nodes
+            else if constexpr (is_same<pak_t, Src> && convable<T, arr_t>)
+                return Pure(arr_t(val.begin(), val.end()));
+            else
+                throw bad_as();
+        });
     }
 
-#undef CHECK_AND_HANDLE
+    /**
+     * hash is structural, equal nodes hash equally whatever their storage
+     * and members of objects are combined regardless of their order
+     * frozen nodes remember their hash, so a frozen tree is hashed once
+     */
+    std::size_t hash() const;
+
+    /**
+     * structural equality, object members compare regardless of their order
+     * and packed arrays equal arrays of the same numbers
+     * frozen nodes compare in O(1) when they share a value or their hashes differ
+     */
+    bool operator==(node const& rhs) const;
+
+    bool operator!=(node const& rhs) const
+    {
+        return !(*this == rhs);
+    }
 
 public:
     template <typename T = std::nullptr_t>
@@ -138,20 +363,22 @@ public:
     }
 
     node(node& src)
+        : data(src.data)
     {
-        auto tmp = src.data;
-        data.swap(tmp);
     }
 
     node(node const& src)
+        : data(src.data)
     {
-        auto tmp = src.data;
-        data.swap(tmp);
     }
 
-    node(node&& src)
+    /**
+     * moves must be noexcept, otherwise std::vector<node>
+     * deep copies every element when it reallocates
+     */
+    node(node&& src) noexcept
+        : data(std::move(src.data))
     {
-        data.swap(src.data);
         src.data = nullptr;
     }
 
@@ -165,15 +392,541 @@ public:
         return *this;
     }
 
-    node& operator=(node&& src)
+    node& operator=(node&& src) noexcept
     {
         if (this == &src)
             return *this;
 
-        data.swap(src.data);
+        data = std::move(src.data);
         src.data = nullptr;
         return *this;
     }
+
+    /**
+     * destruction empties containers into a stack instead of recursing,
+     * so the depth of a tree never touches the call stack
+     * see reclaimer to free large trees off the calling thread
+     */
+    ~node()
+    {
+        auto kind = static_cast<data_k>(data.index());
+        if (kind == data_k::array || kind == data_k::object || kind == data_k::shared)
+            release();
+    }
+
+private:
+    struct stack_cache;
+
+    void release() noexcept;
+    void shed(std::vector<node>& out);
 }; // class node
 
-}; // namespace mini_json
\ No newline at end of file
+static_assert(std::is_nothrow_move_constructible_v<node>);
+static_assert(std::is_nothrow_move_assignable_v<node>);
+
+struct node::share {
+    /**
+     * text_slot is a shared_ptr to a string loaded and stored from many threads
+     * it holds a std::atomic<std::shared_ptr> where the library has one,
+     * otherwise it uses the free atomic functions which C++20 deprecates
+     */
+    class text_slot {
+
+    public:
+        using pointer = std::shared_ptr<std::string const>;
+
+    private:
+#ifdef __cpp_lib_atomic_shared_ptr
+        std::atomic<pointer> ptr;
+#else
+        pointer ptr;
+#endif
+
+    public:
+        pointer load() const noexcept
+        {
+#ifdef __cpp_lib_atomic_shared_ptr
+            return ptr.load();
+#else
+            return std::atomic_load(&ptr);
+#endif
+        }
+
+        void store(pointer val) noexcept
+        {
+#ifdef __cpp_lib_atomic_shared_ptr
+            ptr.store(std::move(val));
+#else
+            std::atomic_store(&ptr, std::move(val));
+#endif
+        }
+    };
+
+    node value;
+
+    // serialized text kept by json::str, see json::str_cache
+    // concurrent writers race benignly, the last store wins
+    mutable text_slot text;
+
+    // hash of value, zero until node::hash computes it
+    mutable std::atomic<std::size_t> digest { 0 };
+};
+
+/**
+ * stack_cache keeps the stack of release warm on every thread,
+ * so freeing a tree does not allocate once the thread freed a similar one
+ * stacks beyond max_nodes are given back instead of being kept
+ */
+struct node::stack_cache {
+    constexpr static std::size_t max_nodes = 4096;
+
+    std::vector<node> nodes;
+    bool busy = false;
+
+    // set once the thread destroyed its cache, nodes freed later bring their own stack
+    inline static thread_local bool gone = false;
+
+    ~stack_cache()
+    {
+        gone = true;
+    }
+
+    static stack_cache* get() noexcept
+    {
+        if (gone)
+            return nullptr;
+        thread_local stack_cache cache;
+        return &cache;
+    }
+};
+
+template <typename Fn>
+template <typename T, node::data_k Key>
+inline auto node::visitor<Fn>::entry<T, Key>::call(Fn& fn, node const& src) -> result
+{
+    if constexpr (is_same<shr_t, T>)
+        return (*std::get_if<shr_t>(&src.data))->value.visit(fn);
+    else if constexpr (is_same<raw_t, T>) {
+        auto const& lazy = *std::get_if<raw_t>(&src.data);
+        if (lazy.is_str)
+            return fn(lazy.string());
+        return fn(lazy.number());
+    } else
+        return fn(*std::get_if<T>(&src.data));
+}
+
+template <typename Fn>
+inline decltype(auto) node::visit(Fn&& fn) const
+{
+    constexpr auto const& table = data_t::table<visitor<Fn>::template entry>;
+    return table[data.index()](fn, *this);
+}
+
+inline std::size_t node::hash_of(nil_t) noexcept
+{
+    return scan::mix(0x6E756C6C);
+}
+
+inline std::size_t node::hash_of(bool val) noexcept
+{
+    return scan::mix(0x626F6F6C + val);
+}
+
+inline std::size_t node::hash_of(num_t val) noexcept
+{
+    // -0.0 equals 0.0, so it hashes like it
+    std::uint64_t bits = 0;
+    if (val != 0)
+        std::memcpy(&bits, &val, sizeof(bits));
+    return scan::mix(bits ^ 0x6E756D);
+}
+
+inline std::size_t node::hash_of(str_t const& val) noexcept
+{
+    return scan::hash(val.data(), val.data() + val.size(), 0x737472);
+}
+
+inline std::size_t node::hash_of(arr_t const& val)
+{
+    std::uint64_t ret = 0x617272 ^ val.size();
+    for (auto const& sub : val)
+        ret = (ret ^ sub.hash()) * 0x9E3779B97F4A7C15ull;
+    return scan::mix(ret);
+}
+
+inline std::size_t node::hash_of(pak_t const& val) noexcept
+{
+    std::uint64_t ret = 0x617272 ^ val.size();
+    for (auto num : val)
+        ret = (ret ^ hash_of(num)) * 0x9E3779B97F4A7C15ull;
+    return scan::mix(ret);
+}
+
+inline std::size_t node::hash_of(obj_t const& val)
+{
+    // a sum of members does not depend on the order of iteration
+    std::uint64_t ret = 0;
+    for (auto const& [key, sub] : val)
+        ret += scan::mix(hash_of(key) ^ (sub.hash() * 0x9E3779B97F4A7C15ull));
+    return scan::mix(ret ^ val.size() ^ 0x6F626A);
+}
+
+inline std::size_t node::hash() const
+{
+    auto const* holder = std::get_if<shr_t>(&data);
+    if (holder)
+        if (std::size_t got = (*holder)->digest.load(std::memory_order_relaxed); got)
+            return got;
+
+    std::size_t ret = visit([](auto const& val) { return hash_of(val); });
+    ret = ret ? ret : 1;
+
+    // every thread computes the same value, so racing stores are harmless
+    if (holder)
+        (*holder)->digest.store(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+template <typename T>
+inline bool node::equal(T const& val, node const& other)
+{
+    if constexpr (is_same<arr_t, T> || is_same<pak_t, T>) {
+        if (auto const* arr = std::get_if<arr_t>(&other.data); arr)
+            return equal_seq(val, *arr);
+        if (auto const* pak = std::get_if<pak_t>(&other.data); pak)
+            return equal_seq(val, *pak);
+        return false;
+    } else if constexpr (is_same<obj_t, T>) {
+        auto const* obj = std::get_if<obj_t>(&other.data);
+        if (!obj || obj->size() != val.size())
+            return false;
+        for (auto const& [key, sub] : val) {
+            auto found = obj->find(key);
+            if (found == obj->end() || sub != found->second)
+                return false;
+        }
+        return true;
+    } else {
+        auto const* same = other.value_if<T>();
+        return same && *same == val;
+    }
+}
+
+template <typename Lhs, typename Rhs>
+inline bool node::equal_seq(Lhs const& lhs, Rhs const& rhs)
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    for (std::size_t i = 0; i < lhs.size(); i++)
+        if (!equal_elem(lhs[i], rhs[i]))
+            return false;
+    return true;
+}
+
+template <typename Lhs, typename Rhs>
+inline bool node::equal_elem(Lhs const& lhs, Rhs const& rhs)
+{
+    if constexpr (is_same<node, Lhs> && is_same<node, Rhs>)
+        return lhs == rhs;
+    else if constexpr (is_same<node, Lhs>)
+        return equal(rhs, lhs.resolve());
+    else if constexpr (is_same<node, Rhs>)
+        return equal(lhs, rhs.resolve());
+    else
+        return lhs == rhs;
+}
+
+inline bool node::operator==(node const& rhs) const
+{
+    auto const* lhold = std::get_if<shr_t>(&data);
+    auto const* rhold = std::get_if<shr_t>(&rhs.data);
+    if (lhold && rhold) {
+        if (*lhold == *rhold)
+            return true;
+        std::size_t lsum = (*lhold)->digest.load(std::memory_order_relaxed);
+        std::size_t rsum = (*rhold)->digest.load(std::memory_order_relaxed);
+        if (lsum && rsum && lsum != rsum)
+            return false;
+    }
+
+    node const& other = rhs.resolve();
+    return visit([&](auto const& val) { return equal(val, other); });
+}
+
+inline node const& node::resolve() const noexcept
+{
+    if (auto const* got = std::get_if<shr_t>(&data); got)
+        return (*got)->value;
+    return *this;
+}
+
+inline void node::unshare()
+{
+    auto holder = std::get<shr_t>(std::move(data));
+
+    // the last owner can take the value, nobody else can observe it
+    if (holder.use_count() == 1)
+        data = std::move(const_cast<node&>(holder->value).data);
+    else
+        data = holder->value.data;
+}
+
+inline void node::unpack()
+{
+    auto const& nums = std::get<pak_t>(resolve().data);
+    data = arr_t(nums.begin(), nums.end());
+}
+
+MINI_JSON_NOINLINE inline void node::release() noexcept
+{
+    // a release nested in another one, which only happens on errors, uses its own stack
+    std::vector<node> own;
+    auto* cache = stack_cache::get();
+    bool warm = cache && !cache->busy;
+    auto& stack = warm ? cache->nodes : own;
+    if (warm)
+        cache->busy = true;
+
+    try {
+        shed(stack);
+        while (!stack.empty()) {
+            node cur = std::move(stack.back());
+            stack.pop_back();
+            cur.shed(stack);
+        }
+    } catch (...) {
+        // out of memory for the stack, the rest is freed recursively
+        stack.clear();
+    }
+
+    if (warm) {
+        if (stack.capacity() > stack_cache::max_nodes)
+            std::vector<node>().swap(stack);
+        cache->busy = false;
+    }
+}
+
+/**
+ * shed moves the children which own further nodes into out
+ * and drops the value, whose remaining children are leaves
+ */
+inline void node::shed(std::vector<node>& out)
+{
+    auto owns = [](node const& sub) {
+        auto kind = static_cast<data_k>(sub.data.index());
+        return kind == data_k::array || kind == data_k::object || kind == data_k::shared;
+    };
+
+    if (auto* arr = std::get_if<arr_t>(&data); arr) {
+        for (auto& sub : *arr) {
+            if (owns(sub))
+                out.push_back(std::move(sub));
+        }
+    } else if (auto* obj = std::get_if<obj_t>(&data); obj) {
+        for (auto& [key, sub] : *obj) {
+            if (owns(sub))
+                out.push_back(std::move(sub));
+        }
+    } else if (auto* holder = std::get_if<shr_t>(&data); holder) {
+        // the last owner frees the shared value, nobody else can observe it
+        if (holder->use_count() == 1)
+            out.push_back(std::move(const_cast<node&>((*holder)->value)));
+    }
+    data = nullptr;
+}
+
+inline node::num_t const& node::raw::number() const
+{
+    if (!ready) {
+        auto first = text.data();
+        auto last = first + text.size();
+        auto [ed, ec] = std::from_chars(first, last, num);
+        // magnitudes beyond double keep the strtod behavior of inf and zero
+        if (ec == std::errc::result_out_of_range)
+            num = std::strtod(text.c_str(), nullptr);
+        ready = true;
+    }
+    return num;
+}
+
+inline node::str_t const& node::raw::string() const
+{
+    if (escaped) {
+        text.resize(scan::unescape(text.data(), text.data() + text.size(), text.data()));
+        escaped = false;
+        ready = true;
+    }
+    return text;
+}
+
+inline void node::decode()
+{
+    auto const& lazy = std::get<raw_t>(resolve().data);
+    if (lazy.is_str)
+        data = str_t(lazy.string());
+    else
+        data = lazy.number();
+}
+
+template <typename T>
+inline T const* node::value_if() const
+{
+    if constexpr (is_same<num_t, T> || is_same<str_t, T>)
+        if (auto const* lazy = std::get_if<raw_t>(&data); lazy)
+            return lazy->is_str == is_same<str_t, T> ? &lazy->value<T>() : nullptr;
+    return std::get_if<T>(&data);
+}
+
+inline node::footprint node::memory_usage() const
+{
+    footprint ret;
+    // strings within the small string buffer own no heap block
+    auto string = [&](str_t const& str) {
+        if (str.capacity() > str_t().capacity()) {
+            ret.strings += str.size() + 1;
+            ret.slack += str.capacity() - str.size();
+        }
+    };
+
+    std::unordered_set<share const*> seen;
+    std::vector<node const*> stack { this };
+    while (!stack.empty()) {
+        auto const& src = stack.back()->data;
+        stack.pop_back();
+
+        if (auto const* holder = std::get_if<shr_t>(&src); holder) {
+            // make_shared puts the share and its counters in one block
+            if (seen.insert(holder->get()).second) {
+                ret.shared += sizeof(share) + 2 * sizeof(void*);
+                stack.push_back(&(*holder)->value);
+            }
+        } else if (auto const* arr = std::get_if<arr_t>(&src); arr) {
+            ret.elements += arr->size() * sizeof(node);
+            ret.slack += (arr->capacity() - arr->size()) * sizeof(node);
+            for (auto const& sub : *arr)
+                stack.push_back(&sub);
+        } else if (auto const* obj = std::get_if<obj_t>(&src); obj) {
+            // every entry is a block with the next pointer and the cached hash
+            ret.members += obj->size() * (sizeof(obj_t::value_type) + 2 * sizeof(void*));
+            ret.buckets += obj->bucket_count() * sizeof(void*);
+            for (auto const& [key, sub] : *obj) {
+                string(key);
+                stack.push_back(&sub);
+            }
+        } else if (auto const* pak = std::get_if<pak_t>(&src); pak) {
+            ret.elements += pak->size() * sizeof(num_t);
+            ret.slack += (pak->capacity() - pak->size()) * sizeof(num_t);
+        } else if (auto const* str = std::get_if<str_t>(&src); str) {
+            string(*str);
+        } else if (auto const* lazy = std::get_if<raw_t>(&src); lazy) {
+            string(lazy->text);
+        }
+    }
+    return ret;
+}
+
+inline void node::compact(bool then_freeze)
+{
+    // pre-order, every container is reallocated before its children
+    std::vector<node*> stack { this };
+    while (!stack.empty()) {
+        auto& dst = stack.back()->data;
+        stack.pop_back();
+
+        if (auto* arr = std::get_if<arr_t>(&dst); arr) {
+            arr_t tmp;
+            tmp.reserve(arr->size());
+            tmp.insert(tmp.end(), std::make_move_iterator(arr->begin()), std::make_move_iterator(arr->end()));
+            arr->swap(tmp);
+            for (auto it = arr->rbegin(); it != arr->rend(); ++it)
+                stack.push_back(&*it);
+        } else if (auto* obj = std::get_if<obj_t>(&dst); obj) {
+            obj_t tmp;
+            tmp.reserve(obj->size());
+            for (auto& [key, sub] : *obj)
+                tmp.emplace(str_t(key), std::move(sub));
+            obj->swap(tmp);
+            auto mark = stack.size();
+            for (auto& [key, sub] : *obj)
+                stack.push_back(&sub);
+            std::reverse(stack.begin() + std::ptrdiff_t(mark), stack.end());
+        } else if (auto* pak = std::get_if<pak_t>(&dst); pak) {
+            pak_t(*pak).swap(*pak);
+        } else if (auto* str = std::get_if<str_t>(&dst); str) {
+            str_t(*str).swap(*str);
+        } else if (auto* lazy = std::get_if<raw_t>(&dst); lazy) {
+            str_t(lazy->text).swap(lazy->text);
+        }
+    }
+
+    if (then_freeze)
+        freeze();
+}
+
+inline bool node::pack()
+{
+    auto const* arr = std::get_if<arr_t>(&data);
+    if (!arr || arr->empty())
+        return false;
+    for (auto const& sub : *arr)
+        if (!std::holds_alternative<num_t>(sub.data))
+            return false;
+
+    pak_t nums;
+    nums.reserve(arr->size());
+    for (auto const& sub : *arr)
+        nums.push_back(std::get<num_t>(sub.data));
+    data = std::move(nums);
+    return true;
+}
+
+inline void node::freeze()
+{
+    // shared values are read from many threads, so nothing may decode later
+    if (auto const* lazy = std::get_if<raw_t>(&data); lazy) {
+        if (lazy->is_str)
+            lazy->string();
+        else
+            lazy->number();
+    }
+
+    switch (type()) {
+    case data_k::array:
+        if (frozen())
+            return;
+        for (auto& sub : std::get<arr_t>(data))
+            sub.freeze();
+        break;
+
+    case data_k::object:
+        if (frozen())
+            return;
+        for (auto& [key, sub] : std::get<obj_t>(data))
+            sub.freeze();
+        break;
+
+    case data_k::string:
+    case data_k::packed:
+        if (frozen())
+            return;
+        break;
+
+    default:
+        // null, number and boolean are cheaper to copy than to share
+        return;
+    }
+
+    auto holder = std::make_shared<share>();
+    holder->value.data = std::move(data);
+    data = shr_t(std::move(holder));
+}
+
+}; // namespace mini_json
+
+template <>
+struct std::hash<mini_json::node> {
+    std::size_t operator()(mini_json::node const& val) const
+    {
+        return val.hash();
+    }
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mini_json {
+
+/**
+ * projection is a set of key paths which the parser materializes
+ * members of objects outside every path are skipped without building nodes
+ * a path selects the whole value at its end, arrays pass the projection
+ * on to their elements, and values on the way which are not objects are kept
+ *
+ * paths are stored as a trie of keys, see json::project
+ */
+class projection {
+
+public:
+    // results of member(), any other value is the trie entry of the member
+    constexpr static std::size_t all = std::size_t(-1);
+    constexpr static std::size_t none = std::size_t(-2);
+
+private:
+    struct entry {
+        std::unordered_map<std::string, std::size_t> children;
+        bool whole = false;
+    };
+
+    std::vector<entry> trie;
+
+public:
+    projection() = default;
+
+    projection(std::initializer_list<std::initializer_list<std::string_view>> paths)
+    {
+        for (auto path : paths)
+            add(path);
+    }
+
+    /**
+     * add one path of keys from the root, the empty path selects everything
+     */
+    template <typename Path>
+    projection& add(Path const& path)
+    {
+        if (trie.empty())
+            trie.emplace_back();
+
+        std::size_t at = 0;
+        for (auto const& key : path) {
+            if (trie[at].whole)
+                return *this;
+
+            auto [got, fresh] = trie[at].children.try_emplace(std::string(key), trie.size());
+            at = got->second;
+            if (fresh)
+                trie.emplace_back();
+        }
+
+        // a shorter path covers everything below it
+        trie[at].whole = true;
+        trie[at].children.clear();
+        return *this;
+    }
+
+    projection& add(std::initializer_list<std::string_view> path)
+    {
+        return add<std::initializer_list<std::string_view>>(path);
+    }
+
+    bool empty() const noexcept
+    {
+        return trie.empty();
+    }
+
+    // trie entry of the root value
+    std::size_t root() const noexcept
+    {
+        return trie.empty() || trie.front().whole ? all : 0;
+    }
+
+    // trie entry of the member key of an object at entry at
+    std::size_t member(std::size_t at, std::string const& key) const
+    {
+        auto const& children = trie[at].children;
+        auto got = children.find(key);
+        if (got == children.end())
+            return none;
+        return trie[got->second].whole ? all : got->second;
+    }
+};
+
+}; // namespace mini_json
@@ -0,0 +1,128 @@
+#pragma once
+#include "node.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mini_json {
+
+/**
+ * reclaimer frees dropped trees on a background thread,
+ * so releasing a large document costs the caller one move
+ * trees which only hold a scalar are freed at once
+ *
+ *     json::reclaimer gc;
+ *     parser.reclaim(&gc); // parse hands the previous tree over
+ *     gc.drop(std::move(result.value));
+ *
+ * the reclaimer must outlive every parser which refers to it,
+ * its destructor frees what is left and joins the thread
+ */
+class reclaimer {
+
+private:
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    // the worker swaps queue with freeing, so both keep their capacity
+    std::vector<node> queue;
+    std::vector<node> freeing;
+    bool busy = false;
+    bool stopping = false;
+    std::size_t freed = 0;
+
+    // started last, once every other member exists
+    std::thread worker;
+
+public:
+    reclaimer()
+        : worker([this] { run(); })
+    {
+    }
+
+    reclaimer(reclaimer const&) = delete;
+    reclaimer& operator=(reclaimer const&) = delete;
+
+    ~reclaimer()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    /**
+     * take tree over, which is left null
+     */
+    void drop(node&& tree);
+
+    /**
+     * wait until every tree dropped so far is freed
+     */
+    void flush();
+
+    /**
+     * number of trees freed by the worker so far
+     */
+    std::size_t count();
+
+private:
+    void run();
+};
+
+inline void reclaimer::drop(node&& tree)
+{
+    auto kind = tree.type();
+    if (kind != node::data_k::array && kind != node::data_k::object) {
+        tree.assign(nullptr);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.push_back(std::move(tree));
+    }
+    wake.notify_one();
+}
+
+inline void reclaimer::flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [&] { return queue.empty() && !busy; });
+}
+
+inline std::size_t reclaimer::count()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return freed;
+}
+
+inline void reclaimer::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [&] { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        queue.swap(freeing);
+        busy = true;
+        guard.unlock();
+
+        std::size_t done = freeing.size();
+        freeing.clear();
+
+        guard.lock();
+        busy = false;
+        freed += done;
+        idle.notify_all();
+    }
+}
+
+}; // namespace mini_json
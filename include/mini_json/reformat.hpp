@@ -0,0 +1,268 @@
+#pragma once
+#include "scan.hpp"
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace mini_json {
+
+/**
+ * reformatter minifies or pretty prints JSON text without building a tree
+ * input is fed in chunks of any size and the output is produced in one pass
+ * numbers, literals and strings are copied byte-exact
+ * consecutive top-level values, as in NDJSON, are written one per line
+ * memory is constant: a fixed output buffer plus a few bytes of state
+ *
+ * reformatter does not validate, feed it trusted input or run json::validate
+ * finish only reports unbalanced containers and unterminated strings
+ */
+class reformatter {
+
+public:
+    /**
+     * indent is the number of indent_char per level, zero means minify
+     */
+    struct options {
+        std::size_t indent = 0;
+        char indent_char = ' ';
+        std::size_t buffer = 64 * 1024;
+    };
+
+    // bytes read at a time by transform
+    constexpr static std::size_t chunk_size = 64 * 1024;
+
+private:
+    options opts;
+    std::string out;
+
+    std::size_t depth = 0;
+    bool in_string = false;
+    bool escape = false;
+    // a container was opened and its first token decides between {} and a new line
+    bool pending = false;
+    // a top-level value was written, the next one starts on a new line
+    bool done = false;
+    // the output ends with a number or literal which the next chunk may continue
+    bool scalar = false;
+
+public:
+    reformatter()
+        : reformatter(options {})
+    {
+    }
+
+    explicit reformatter(options init)
+        : opts(init)
+    {
+        out.reserve(opts.buffer);
+    }
+
+    /**
+     * feed one chunk of input, sink receives std::string_view pieces of output
+     */
+    template <typename Sink>
+    void feed(std::string_view chunk, Sink&& sink);
+
+    /**
+     * flush the remaining output
+     * returns false if the input ended inside a string or an open container
+     */
+    template <typename Sink>
+    bool finish(Sink&& sink)
+    {
+        flush(sink);
+        bool ok = depth == 0 && !in_string && !pending;
+        depth = 0;
+        in_string = escape = pending = done = scalar = false;
+        return ok;
+    }
+
+    /**
+     * reformat a whole stream, reading chunk bytes at a time
+     * a chunk of zero reads chunk_size bytes
+     */
+    static bool transform(std::istream& in, std::ostream& os)
+    {
+        return transform(in, os, options {});
+    }
+
+    static bool transform(std::istream& in, std::ostream& os, options init, std::size_t chunk = chunk_size)
+    {
+        reformatter fmt(init);
+        std::string buf(chunk ? chunk : chunk_size, '\0');
+        auto sink = [&](std::string_view piece) { os.write(piece.data(), std::streamsize(piece.size())); };
+
+        while (in) {
+            in.read(buf.data(), std::streamsize(buf.size()));
+            fmt.feed(std::string_view(buf.data(), std::size_t(in.gcount())), sink);
+        }
+        return fmt.finish(sink) && !os.fail();
+    }
+
+private:
+    template <typename Sink>
+    void flush(Sink& sink)
+    {
+        if (!out.empty())
+            sink(std::string_view(out));
+        out.clear();
+    }
+
+    template <typename Sink>
+    void put(Sink& sink, char const* src, std::size_t len)
+    {
+        if (out.size() + len > opts.buffer)
+            flush(sink);
+        if (len > opts.buffer)
+            sink(std::string_view(src, len));
+        else
+            out.append(src, len);
+    }
+
+    template <typename Sink>
+    void put(Sink& sink, char ch)
+    {
+        if (out.size() == opts.buffer)
+            flush(sink);
+        out.push_back(ch);
+    }
+
+    template <typename Sink>
+    void newline(Sink& sink)
+    {
+        put(sink, '\n');
+        for (std::size_t i = depth * opts.indent; i > 0;) {
+            std::size_t room = opts.buffer - out.size();
+            if (room == 0) {
+                flush(sink);
+                continue;
+            }
+            std::size_t len = i < room ? i : room;
+            out.append(len, opts.indent_char);
+            i -= len;
+        }
+    }
+
+    // ch is the first token after an opening bracket
+    template <typename Sink>
+    void open_pending(Sink& sink, char ch)
+    {
+        pending = false;
+        if (ch == '}' || ch == ']')
+            return;
+
+        ++depth;
+        if (opts.indent)
+            newline(sink);
+    }
+};
+
+template <typename Sink>
+inline void reformatter::feed(std::string_view chunk, Sink&& sink)
+{
+    char const* it = chunk.data();
+    char const* end = it + chunk.size();
+
+    while (it != end) {
+        if (in_string) {
+            // a backslash at the end of the previous chunk escapes this byte
+            if (escape) {
+                escape = false;
+                put(sink, *it++);
+                continue;
+            }
+
+            auto st = it;
+            it = scan::quote(it, end);
+            put(sink, st, std::size_t(it - st));
+            if (it == end)
+                break;
+
+            put(sink, *it);
+            if (*it++ == '\"') {
+                in_string = false;
+                done = depth == 0;
+            } else
+                escape = true;
+            continue;
+        }
+
+        auto st = it;
+        it = scan::ws(it, end);
+        if (it != st)
+            scalar = false;
+        if (it == end)
+            break;
+
+        char ch = *it;
+        if (done && !scalar) {
+            put(sink, '\n');
+            done = false;
+        }
+        scalar = false;
+
+        bool empty = false;
+        if (pending) {
+            empty = ch == '}' || ch == ']';
+            open_pending(sink, ch);
+        }
+
+        switch (ch) {
+        case '{':
+        case '[':
+            put(sink, ch);
+            pending = true;
+            ++it;
+            break;
+
+        case '}':
+        case ']':
+            // empty containers stay on one line and never entered a level
+            if (!empty && depth) {
+                --depth;
+                if (opts.indent)
+                    newline(sink);
+            }
+            put(sink, ch);
+            done = depth == 0;
+            ++it;
+            break;
+
+        case ',':
+            put(sink, ch);
+            if (opts.indent)
+                newline(sink);
+            ++it;
+            break;
+
+        case ':':
+            put(sink, ch);
+            if (opts.indent)
+                put(sink, ' ');
+            ++it;
+            break;
+
+        case '\"':
+            put(sink, ch);
+            in_string = true;
+            ++it;
+            break;
+
+        default: {
+            // numbers and literals end at whitespace or structure
+            auto st = it;
+            while (it != end && *it != ',' && *it != ']' && *it != '}' && *it != ':'
+                && *it != ' ' && *it != '\n' && *it != '\t' && *it != '\r')
+                ++it;
+            put(sink, st, std::size_t(it - st));
+            done = depth == 0;
+            scalar = it == end;
+            break;
+        }
+        }
+    }
+}
+
+}; // namespace mini_json
@@ -0,0 +1,463 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mini_json {
+
+/**
+ * scan provides the byte level primitives shared by validation and parsing
+ * words of 8 bytes are tested at once (SWAR), which compilers vectorize
+ * without depending on any instruction set
+ */
+namespace scan {
+
+    using word = std::uint64_t;
+
+    constexpr word ones = 0x0101010101010101ull;
+    constexpr word lows = 0x7F7F7F7F7F7F7F7Full;
+    constexpr word highs = 0x8080808080808080ull;
+
+    inline word load(char const* src) noexcept
+    {
+        word ret;
+        std::memcpy(&ret, src, sizeof(ret));
+        return ret;
+    }
+
+    // high bit set in every byte of v which is zero
+    // carries never cross bytes, so every flag is exact
+    constexpr word zero_bytes(word v) noexcept
+    {
+        return ~(((v & lows) + lows) | v) & highs;
+    }
+
+    // high bit set in every byte of v which equals ch
+    constexpr word equal_bytes(word v, unsigned char ch) noexcept
+    {
+        return zero_bytes(v ^ (ones * ch));
+    }
+
+    // high bit set in every byte of v which is below n (n <= 128)
+    constexpr word less_bytes(word v, unsigned char n) noexcept
+    {
+        return ~(((v & lows) + ones * (0x80 - n)) | v) & highs;
+    }
+
+    // high bit set in every byte of v which is JSON whitespace
+    constexpr word ws_bytes(word v) noexcept
+    {
+        return equal_bytes(v, ' ') | equal_bytes(v, '\n') | equal_bytes(v, '\t') | equal_bytes(v, '\r');
+    }
+
+    /**
+     * plain returns the first byte in [it, end) which ends a run of string content:
+     * a quote, a backslash, a control charactor or a non-ASCII byte
+     */
+    inline char const* plain(char const* it, char const* end) noexcept
+    {
+        while (end - it >= 8) {
+            word v = load(it);
+            if (equal_bytes(v, '\"') | equal_bytes(v, '\\') | less_bytes(v, 0x20) | (v & highs))
+                break;
+            it += 8;
+        }
+
+        while (it != end) {
+            auto ch = static_cast<unsigned char>(*it);
+            if (ch == '\"' || ch == '\\' || ch < 0x20 || ch >= 0x80)
+                break;
+            ++it;
+        }
+        return it;
+    }
+
+    /**
+     * escaped returns the first byte in [it, end) which output must escape:
+     * a quote, a backslash or a control charactor
+     */
+    inline char const* escaped(char const* it, char const* end) noexcept
+    {
+        while (end - it >= 8) {
+            word v = load(it);
+            if (equal_bytes(v, '\"') | equal_bytes(v, '\\') | less_bytes(v, 0x20))
+                break;
+            it += 8;
+        }
+
+        while (it != end && *it != '\"' && *it != '\\' && static_cast<unsigned char>(*it) >= 0x20)
+            ++it;
+        return it;
+    }
+
+    constexpr bool needs_escape(char ch) noexcept
+    {
+        return ch == '\"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20;
+    }
+
+    /**
+     * escape writes the escape sequence of ch, a byte found by escaped,
+     * into out which has room for 6 bytes, returns its length
+     * control charactors without a short form become \u00XX
+     */
+    constexpr std::size_t escape(char ch, char* out) noexcept
+    {
+        char code = 0;
+        switch (ch) {
+        case '\"':
+            code = '\"';
+            break;
+        case '\\':
+            code = '\\';
+            break;
+        case '\b':
+            code = 'b';
+            break;
+        case '\f':
+            code = 'f';
+            break;
+        case '\n':
+            code = 'n';
+            break;
+        case '\r':
+            code = 'r';
+            break;
+        case '\t':
+            code = 't';
+            break;
+        default: {
+            constexpr char const* digits = "0123456789abcdef";
+            auto byte = static_cast<unsigned char>(ch);
+            out[0] = '\\';
+            out[1] = 'u';
+            out[2] = '0';
+            out[3] = '0';
+            out[4] = digits[byte >> 4];
+            out[5] = digits[byte & 0xF];
+            return 6;
+        }
+        }
+
+        out[0] = '\\';
+        out[1] = code;
+        return 2;
+    }
+
+    /**
+     * escaped_size is the length of [it, end) once escaped
+     */
+    inline std::size_t escaped_size(char const* it, char const* end) noexcept
+    {
+        std::size_t ret = std::size_t(end - it);
+        while ((it = escaped(it, end)) != end) {
+            char tmp[6];
+            ret += escape(*it++, tmp) - 1;
+        }
+        return ret;
+    }
+
+    /**
+     * ascii returns the first non-ASCII byte in [it, end)
+     */
+    inline char const* ascii(char const* it, char const* end) noexcept
+    {
+        while (end - it >= 8 && !(load(it) & highs))
+            it += 8;
+        while (it != end && !(static_cast<unsigned char>(*it) & 0x80))
+            ++it;
+        return it;
+    }
+
+    /**
+     * utf8 checks one multi-byte sequence starting at it
+     * overlong forms, surrogates and code points beyond U+10FFFF are rejected
+     * it is advanced past the sequence on success
+     */
+    inline bool utf8(char const*& it, char const* end) noexcept
+    {
+        auto byte = [&](std::ptrdiff_t i) { return static_cast<unsigned char>(it[i]); };
+        auto cont = [&](std::ptrdiff_t i) { return (byte(i) & 0xC0) == 0x80; };
+
+        unsigned char lead = byte(0);
+        std::ptrdiff_t left = end - it;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            if (left < 2 || !cont(1))
+                return false;
+            it += 2;
+            return true;
+        }
+
+        if (lead >= 0xE0 && lead <= 0xEF) {
+            if (left < 3 || !cont(1) || !cont(2))
+                return false;
+            // E0 needs A0..BF (no overlong), ED needs 80..9F (no surrogates)
+            if ((lead == 0xE0 && byte(1) < 0xA0) || (lead == 0xED && byte(1) > 0x9F))
+                return false;
+            it += 3;
+            return true;
+        }
+
+        if (lead >= 0xF0 && lead <= 0xF4) {
+            if (left < 4 || !cont(1) || !cont(2) || !cont(3))
+                return false;
+            // F0 needs 90..BF (no overlong), F4 needs 80..8F (up to U+10FFFF)
+            if ((lead == 0xF0 && byte(1) < 0x90) || (lead == 0xF4 && byte(1) > 0x8F))
+                return false;
+            it += 4;
+            return true;
+        }
+
+        return false;
+    }
+
+    // value of every hex digit, -1 for other bytes
+    constexpr std::array<std::int8_t, 256> hex_digits = [] {
+        std::array<std::int8_t, 256> ret {};
+        for (auto& digit : ret)
+            digit = -1;
+        for (int i = 0; i < 10; i++)
+            ret['0' + i] = std::int8_t(i);
+        for (int i = 0; i < 6; i++)
+            ret['a' + i] = ret['A' + i] = std::int8_t(10 + i);
+        return ret;
+    }();
+
+    /**
+     * hex4 decodes four hex digits, returns a value above 0xFFFF on bad digits
+     * a bad digit turns the sign of the combined lookups, one branch in total
+     */
+    inline std::uint32_t hex4(char const* src) noexcept
+    {
+        auto digit = [&](int i) { return std::int32_t(hex_digits[static_cast<unsigned char>(src[i])]); };
+        std::int32_t d0 = digit(0), d1 = digit(1), d2 = digit(2), d3 = digit(3);
+        if ((d0 | d1 | d2 | d3) < 0)
+            return 0x10000;
+        return std::uint32_t(d0 << 12 | d1 << 8 | d2 << 4 | d3);
+    }
+
+    /**
+     * unicode decodes the escape at it, which points to the u of \uXXXX
+     * a high surrogate must be followed by the escape of a low one,
+     * and the pair is combined into one code point
+     * returns a value above 0x10FFFF on bad digits and unpaired surrogates,
+     * otherwise it is advanced past the escape
+     */
+    inline std::uint32_t unicode(char const*& it, char const* end) noexcept
+    {
+        constexpr std::uint32_t bad = 0x110000;
+        if (end - it < 5)
+            return bad;
+
+        std::uint32_t code = hex4(it + 1);
+        if (code > 0xFFFF || (code >= 0xDC00 && code <= 0xDFFF))
+            return bad;
+
+        if (code < 0xD800 || code > 0xDBFF) {
+            it += 5;
+            return code;
+        }
+
+        if (end - it < 11 || it[5] != '\\' || it[6] != 'u')
+            return bad;
+
+        std::uint32_t low = hex4(it + 7);
+        if (low < 0xDC00 || low > 0xDFFF)
+            return bad;
+
+        it += 11;
+        return 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    /**
+     * encode writes code point code as UTF-8 into out, returns its length
+     */
+    inline std::size_t encode(std::uint32_t code, char* out) noexcept
+    {
+        if (code <= 0x7F) {
+            out[0] = char(code);
+            return 1;
+        }
+
+        if (code <= 0x7FF) {
+            out[0] = char(0xC0 | (code >> 6));
+            out[1] = char(0x80 | (code & 0x3F));
+            return 2;
+        }
+
+        if (code <= 0xFFFF) {
+            out[0] = char(0xE0 | (code >> 12));
+            out[1] = char(0x80 | ((code >> 6) & 0x3F));
+            out[2] = char(0x80 | (code & 0x3F));
+            return 3;
+        }
+
+        out[0] = char(0xF0 | (code >> 18));
+        out[1] = char(0x80 | ((code >> 12) & 0x3F));
+        out[2] = char(0x80 | ((code >> 6) & 0x3F));
+        out[3] = char(0x80 | (code & 0x3F));
+        return 4;
+    }
+
+    /**
+     * quote returns the first quote or backslash in [it, end)
+     */
+    inline char const* quote(char const* it, char const* end) noexcept
+    {
+        while (end - it >= 8) {
+            word v = load(it);
+            if (equal_bytes(v, '\"') | equal_bytes(v, '\\'))
+                break;
+            it += 8;
+        }
+
+        while (it != end && *it != '\"' && *it != '\\')
+            ++it;
+        return it;
+    }
+
+    /**
+     * unescape decodes the body of a string which the parser already checked
+     * into out and returns its length, the output is never longer than the input
+     * so out may be the input itself
+     */
+    inline std::size_t unescape(char const* it, char const* end, char* out) noexcept
+    {
+        auto first = out;
+        while (true) {
+            // a checked body has no quotes, so the scan stops at backslashes
+            auto st = it;
+            it = quote(it, end);
+            std::memmove(out, st, std::size_t(it - st));
+            out += it - st;
+            if (it == end)
+                return std::size_t(out - first);
+
+            ++it;
+            switch (*it) {
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'u': {
+                char tmp[4];
+                std::size_t len = encode(unicode(it, end), tmp);
+                std::memcpy(out, tmp, len);
+                out += len;
+                continue;
+            }
+            default:
+                // quote, backslash and slash stand for themselves
+                *out++ = *it;
+                break;
+            }
+            ++it;
+        }
+    }
+
+    /**
+     * ws returns the first non-whitespace byte in [it, end)
+     * indentation of pretty printed input is skipped a word at a time
+     */
+    inline char const* ws(char const* it, char const* end) noexcept
+    {
+        while (end - it >= 8 && ws_bytes(load(it)) == highs)
+            it += 8;
+        while (it != end && (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r'))
+            ++it;
+        return it;
+    }
+
+    /**
+     * number advances it past a number of RFC 8259 grammar
+     * -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+     */
+    inline bool number(char const*& it, char const* end) noexcept
+    {
+        auto digit = [&] { return it != end && *it >= '0' && *it <= '9'; };
+        auto digits = [&] {
+            if (!digit())
+                return false;
+            while (digit())
+                ++it;
+            return true;
+        };
+
+        if (it != end && *it == '-')
+            ++it;
+
+        if (it != end && *it == '0')
+            ++it;
+        else if (!digits())
+            return false;
+
+        if (it != end && *it == '.') {
+            ++it;
+            if (!digits())
+                return false;
+        }
+
+        if (it != end && (*it == 'e' || *it == 'E')) {
+            ++it;
+            if (it != end && (*it == '+' || *it == '-'))
+                ++it;
+            if (!digits())
+                return false;
+        }
+        return true;
+    }
+
+    // final mix of a 64 bit hash, every input bit affects every output bit
+    constexpr word mix(word v) noexcept
+    {
+        v ^= v >> 33;
+        v *= 0xFF51AFD7ED558CCDull;
+        v ^= v >> 33;
+        v *= 0xC4CEB9FE1A85EC53ull;
+        v ^= v >> 33;
+        return v;
+    }
+
+    /**
+     * hash consumes [it, end) a word at a time
+     * the four lanes are independent, so their multiplies overlap
+     */
+    inline word hash(char const* it, char const* end, word seed) noexcept
+    {
+        constexpr word prime = 0x9E3779B97F4A7C15ull;
+        word lane[4] = { seed, seed ^ prime, seed + prime, ~seed };
+        word len = word(end - it);
+
+        while (end - it >= 32) {
+            for (int i = 0; i < 4; i++)
+                lane[i] = (lane[i] ^ load(it + 8 * i)) * prime;
+            it += 32;
+        }
+        while (end - it >= 8) {
+            lane[0] = (lane[0] ^ load(it)) * prime;
+            it += 8;
+        }
+
+        word tail = 0;
+        std::memcpy(&tail, it, std::size_t(end - it));
+        lane[1] = (lane[1] ^ tail) * prime;
+
+        auto rotl = [](word v, int n) { return (v << n) | (v >> (64 - n)); };
+        return mix(lane[0] ^ mix(lane[1] ^ len) ^ rotl(lane[2], 21) ^ rotl(lane[3], 42));
+    }
+
+}; // namespace scan
+
+}; // namespace mini_json
@@ -0,0 +1,340 @@
+#pragma once
+#include "exception.hpp"
+#include "node.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mini_json {
+
+/**
+ * schema is a compiled JSON Schema which json::parse checks while parsing
+ * the first violation stops the parse with error_code::schema_violation
+ *
+ * the supported keywords are type, properties, required, additionalProperties,
+ * items, enum, minimum, maximum and maxLength, other keywords are ignored
+ * a member whose schema is { "x-ignore": true } is skipped like a member
+ * outside the projection, neither built nor checked
+ *
+ * rules are stored in one vector and refer to each other by index,
+ * like the entries of projection
+ */
+class schema {
+
+public:
+    // entries returned instead of a rule, any accepts every value
+    constexpr static std::size_t any = std::size_t(-1);
+    constexpr static std::size_t skip = std::size_t(-2);
+    constexpr static std::size_t reject = std::size_t(-3);
+
+    // required members are tracked in one word per open object
+    constexpr static std::size_t max_required = 64;
+
+private:
+    struct property {
+        std::size_t rule;
+        std::uint64_t bit;
+    };
+
+    struct rule {
+        // one bit per node::data_k, integer further restricts numbers
+        unsigned types = ~0u;
+        bool integer = false;
+        double minimum = -std::numeric_limits<double>::infinity();
+        double maximum = std::numeric_limits<double>::infinity();
+        std::size_t max_length = std::size_t(-1);
+        bool has_enum = false;
+        std::vector<node> enumeration;
+        std::unordered_map<std::string, property> properties;
+        std::uint64_t required = 0;
+        std::size_t items = any;
+        std::size_t additional = any;
+    };
+
+    std::vector<rule> rules;
+    std::size_t top = any;
+
+public:
+    // an empty schema accepts everything
+    schema() = default;
+
+    /**
+     * compile a schema document, throws bad_schema when a supported
+     * keyword is malformed or uses a form which is not supported
+     */
+    explicit schema(node const& doc)
+    {
+        top = compile(doc, false);
+    }
+
+    bool empty() const noexcept
+    {
+        return top == any;
+    }
+
+    // rule of the root value
+    std::size_t root() const noexcept
+    {
+        return top;
+    }
+
+    // rule of the elements of an array at rule at
+    std::size_t items(std::size_t at) const noexcept
+    {
+        return at == any ? any : rules[at].items;
+    }
+
+    /**
+     * rule of the member key of an object at rule at
+     * bit is set to the required bit of key, zero when it is optional
+     */
+    std::size_t member(std::size_t at, std::string const& key, std::uint64_t& bit) const
+    {
+        bit = 0;
+        if (at == any)
+            return any;
+
+        auto const& cur = rules[at];
+        auto got = cur.properties.find(key);
+        if (got == cur.properties.end())
+            return cur.additional;
+
+        bit = got->second.bit;
+        return got->second.rule;
+    }
+
+    /**
+     * accepts checks the type of a value from its first charactor
+     * so mismatches are found before the value is parsed
+     * charactors which start no value are left to the parser
+     */
+    bool accepts(std::size_t at, char first) const noexcept;
+
+    /**
+     * check a complete value, seen holds the required bits of its members
+     * the type was already checked by accepts
+     */
+    bool check(std::size_t at, node const& val, std::uint64_t seen) const;
+
+private:
+    std::size_t compile(node const& doc, bool is_member);
+    static unsigned type_bits(std::string const& name, bool& integer);
+
+    constexpr static unsigned bit_of(node::data_k kind) noexcept
+    {
+        return 1u << static_cast<unsigned>(kind);
+    }
+
+    // length in code points, the parser only produces valid UTF-8
+    static std::size_t length(std::string const& str) noexcept
+    {
+        std::size_t ret = 0;
+        for (char ch : str)
+            ret += (static_cast<unsigned char>(ch) & 0xC0) != 0x80;
+        return ret;
+    }
+};
+
+inline bool schema::accepts(std::size_t at, char first) const noexcept
+{
+    using data_k = node::data_k;
+
+    data_k kind;
+    switch (first) {
+    case '{':
+        kind = data_k::object;
+        break;
+    case '[':
+        kind = data_k::array;
+        break;
+    case '\"':
+        kind = data_k::string;
+        break;
+    case 'n':
+        kind = data_k::null;
+        break;
+    case 't':
+    case 'f':
+        kind = data_k::boolean;
+        break;
+    default:
+        if (first != '-' && (first < '0' || first > '9'))
+            return true;
+        kind = data_k::number;
+        break;
+    }
+    return rules[at].types & bit_of(kind);
+}
+
+inline bool schema::check(std::size_t at, node const& val, std::uint64_t seen) const
+{
+    using data_k = node::data_k;
+    auto const& cur = rules[at];
+
+    switch (val.type()) {
+    case data_k::number: {
+        double num = val.get<double>();
+        if (cur.integer && num != std::trunc(num))
+            return false;
+        if (num < cur.minimum || num > cur.maximum)
+            return false;
+        break;
+    }
+
+    case data_k::string:
+        if (cur.max_length != std::size_t(-1) && length(val.get<std::string>()) > cur.max_length)
+            return false;
+        break;
+
+    case data_k::object:
+        if ((seen & cur.required) != cur.required)
+            return false;
+        break;
+
+    default:
+        break;
+    }
+
+    if (cur.has_enum)
+        return std::find(cur.enumeration.begin(), cur.enumeration.end(), val) != cur.enumeration.end();
+    return true;
+}
+
+inline unsigned schema::type_bits(std::string const& name, bool& integer)
+{
+    using data_k = node::data_k;
+
+    if (name == "null")
+        return bit_of(data_k::null);
+    if (name == "boolean")
+        return bit_of(data_k::boolean);
+    if (name == "number")
+        return bit_of(data_k::number);
+    if (name == "string")
+        return bit_of(data_k::string);
+    if (name == "array")
+        return bit_of(data_k::array);
+    if (name == "object")
+        return bit_of(data_k::object);
+    if (name == "integer") {
+        integer = true;
+        return bit_of(data_k::number);
+    }
+    throw bad_schema();
+}
+
+/**
+ * compile appends the rule of doc and returns its index
+ * schemas without constraints compile to any
+ */
+inline std::size_t schema::compile(node const& doc, bool is_member)
+{
+    using data_k = node::data_k;
+    using Obj = std::unordered_map<std::string, node>;
+    using Arr = std::vector<node>;
+
+    rule ret;
+    if (doc.type() == data_k::boolean) {
+        if (doc.get<bool>())
+            return any;
+        ret.types = 0;
+        rules.push_back(std::move(ret));
+        return rules.size() - 1;
+    }
+
+    if (doc.type() != data_k::object)
+        throw bad_schema();
+
+    auto const& obj = doc.get<Obj>();
+    if (auto got = obj.find("x-ignore"); got != obj.end() && got->second.as<bool>())
+        return is_member ? skip : any;
+
+    bool constrained = false;
+    auto keyword = [&](char const* name, unsigned kinds) -> node const* {
+        auto got = obj.find(name);
+        if (got == obj.end())
+            return nullptr;
+        if (!(kinds & bit_of(got->second.type())))
+            throw bad_schema();
+        constrained = true;
+        return &got->second;
+    };
+
+    constexpr unsigned any_schema = bit_of(data_k::object) | bit_of(data_k::boolean);
+    constexpr unsigned list = bit_of(data_k::array) | bit_of(data_k::packed);
+
+    if (auto val = keyword("type", bit_of(data_k::string) | bit_of(data_k::array))) {
+        bool integer = false, number = false;
+        ret.types = 0;
+        for (auto const& name : val->type() == data_k::array ? val->get<Arr>() : Arr { *val }) {
+            if (name.type() != data_k::string)
+                throw bad_schema();
+            auto const& str = name.get<std::string>();
+            number = number || str == "number";
+            ret.types |= type_bits(str, integer);
+        }
+        ret.integer = integer && !number;
+    }
+
+    if (auto val = keyword("minimum", bit_of(data_k::number)))
+        ret.minimum = val->get<double>();
+    if (auto val = keyword("maximum", bit_of(data_k::number)))
+        ret.maximum = val->get<double>();
+
+    if (auto val = keyword("maxLength", bit_of(data_k::number))) {
+        double len = val->get<double>();
+        if (len < 0 || len != std::trunc(len))
+            throw bad_schema();
+        ret.max_length = std::size_t(len);
+    }
+
+    if (auto val = keyword("enum", list)) {
+        ret.has_enum = true;
+        ret.enumeration = val->as<Arr>();
+    }
+
+    if (auto val = keyword("properties", bit_of(data_k::object))) {
+        for (auto const& [key, sub] : val->get<Obj>())
+            ret.properties[key] = { compile(sub, true), 0 };
+    }
+
+    if (auto val = keyword("required", bit_of(data_k::array))) {
+        auto const& names = val->get<Arr>();
+        if (names.size() > max_required)
+            throw bad_schema();
+        std::uint64_t bit = 1;
+        for (auto const& name : names) {
+            if (name.type() != data_k::string)
+                throw bad_schema();
+            auto [got, fresh] = ret.properties.try_emplace(name.get<std::string>(), property { any, 0 });
+            if (got->second.bit == 0) {
+                got->second.bit = bit;
+                ret.required |= bit;
+                bit <<= 1;
+            }
+        }
+    }
+
+    if (auto val = keyword("additionalProperties", any_schema)) {
+        if (val->type() == data_k::boolean && !val->get<bool>())
+            ret.additional = reject;
+        else
+            ret.additional = compile(*val, true);
+    }
+
+    // the tuple form of items is not supported
+    if (auto val = keyword("items", any_schema))
+        ret.items = compile(*val, false);
+
+    if (!constrained)
+        return any;
+    rules.push_back(std::move(ret));
+    return rules.size() - 1;
+}
+
+}; // namespace mini_json
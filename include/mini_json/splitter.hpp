@@ -0,0 +1,197 @@
+#pragma once
+#include "json.hpp"
+#include "scan.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace mini_json {
+
+/**
+ * splitter frames the elements of a top-level array fed in chunks
+ * each complete element is handed out as text, ready for json::parse,
+ * so only one element is buffered at a time however long the array is
+ *
+ * framing only tracks strings and bracket depth, the grammar of every
+ * element is left to the parser
+ */
+class splitter {
+
+private:
+    enum class state {
+        open,
+        first,
+        next,
+        element,
+        closed,
+    };
+
+    std::string buf;
+    state st = state::open;
+    std::size_t depth = 0;
+    bool in_string = false;
+    bool escape = false;
+    bool complete = false;
+    json::error_code err = json::error_code::non;
+
+public:
+    /**
+     * consume bytes of chunk until an element is complete or chunk runs out
+     * returns the number of bytes consumed, feed the rest after pop()
+     */
+    std::size_t feed(std::string_view chunk);
+
+    /**
+     * element() holds a complete element until pop()
+     */
+    bool ready() const noexcept
+    {
+        return complete;
+    }
+
+    std::string_view element() const noexcept
+    {
+        return buf;
+    }
+
+    void pop() noexcept
+    {
+        buf.clear();
+        complete = false;
+    }
+
+    /**
+     * the closing bracket of the array was seen
+     */
+    bool closed() const noexcept
+    {
+        return st == state::closed;
+    }
+
+    json::error_code error() const noexcept
+    {
+        return err;
+    }
+
+    /**
+     * report the end of input, the array must have been closed
+     */
+    json::error_code finish() noexcept
+    {
+        if (err != json::error_code::non)
+            return err;
+
+        if (st == state::open)
+            err = json::error_code::expect_value;
+        else if (in_string)
+            err = json::error_code::invalid_value;
+        else if (st != state::closed)
+            err = json::error_code::miss_separator;
+        return err;
+    }
+
+    /**
+     * start over for the next array, the buffer keeps its capacity
+     */
+    void reset() noexcept
+    {
+        pop();
+        st = state::open;
+        depth = 0;
+        in_string = escape = false;
+        err = json::error_code::non;
+    }
+};
+
+inline std::size_t splitter::feed(std::string_view chunk)
+{
+    char const* st_chunk = chunk.data();
+    char const* it = st_chunk;
+    char const* end = it + chunk.size();
+
+    while (it != end && !complete && err == json::error_code::non) {
+        switch (st) {
+        case state::open:
+            it = scan::ws(it, end);
+            if (it == end)
+                break;
+            if (*it != '[') {
+                err = json::error_code::invalid_value;
+                break;
+            }
+            ++it;
+            st = state::first;
+            break;
+
+        case state::first:
+        case state::next:
+            it = scan::ws(it, end);
+            if (it == end)
+                break;
+            if (st == state::first && *it == ']') {
+                ++it;
+                st = state::closed;
+                break;
+            }
+            st = state::element;
+            break;
+
+        case state::element: {
+            if (in_string) {
+                // a backslash at the end of the previous chunk escapes this byte
+                if (escape) {
+                    escape = false;
+                    buf.push_back(*it++);
+                    break;
+                }
+
+                auto run = it;
+                it = scan::quote(it, end);
+                buf.append(run, it);
+                if (it == end)
+                    break;
+
+                if (*it == '\"')
+                    in_string = false;
+                else
+                    escape = true;
+                buf.push_back(*it++);
+                break;
+            }
+
+            auto run = it;
+            while (it != end && *it != '\"' && *it != ',' && *it != '[' && *it != ']' && *it != '{' && *it != '}')
+                ++it;
+            buf.append(run, it);
+            if (it == end)
+                break;
+
+            char ch = *it++;
+            if (depth == 0 && (ch == ',' || ch == ']')) {
+                complete = true;
+                st = ch == ',' ? state::next : state::closed;
+                break;
+            }
+
+            if (ch == '\"')
+                in_string = true;
+            else if (ch == '[' || ch == '{')
+                ++depth;
+            else if ((ch == ']' || ch == '}') && depth)
+                --depth;
+            buf.push_back(ch);
+            break;
+        }
+
+        case state::closed:
+            it = scan::ws(it, end);
+            if (it != end)
+                err = json::error_code::root_singular;
+            break;
+        }
+    }
+
+    return std::size_t(it - st_chunk);
+}
+
+}; // namespace mini_json
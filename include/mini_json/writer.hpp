@@ -0,0 +1,296 @@
+#pragma once
+#include "exception.hpp"
+#include "scan.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace mini_json {
+
+/**
+ * literal_key is a key escaped at compile time
+ * it holds the whole quoted text including the separator after it
+ *
+ *     constexpr json::literal_key id("id");
+ *     writer.key(id);
+ */
+template <std::size_t N>
+class literal_key {
+
+private:
+    // every byte escapes to 6 at most, plus quotes and ": "
+    char text[6 * N + 4] {};
+    std::size_t len = 0;
+
+public:
+    constexpr literal_key(char const (&src)[N])
+    {
+        text[len++] = '\"';
+        for (std::size_t i = 0; i + 1 < N; i++) {
+            if (scan::needs_escape(src[i]))
+                len += scan::escape(src[i], text + len);
+            else
+                text[len++] = src[i];
+        }
+        text[len++] = '\"';
+        text[len++] = ':';
+        text[len++] = ' ';
+    }
+
+    constexpr std::string_view view() const noexcept
+    {
+        return std::string_view(text, len);
+    }
+};
+
+/**
+ * basic_json_writer serializes straight into a growable buffer without building nodes
+ * separators and escapes are those of json::str, but numbers are written in
+ * their shortest round-trip form where str uses six fixed decimals
+ * once the buffer is warm, writing a document does not allocate
+ *
+ * when Checked, misplaced calls throw bad_write, see json_writer
+ * unchecked writers trust the caller and only keep the separators right
+ */
+template <bool Checked>
+class basic_json_writer {
+
+public:
+    constexpr static bool checked = Checked;
+
+    // nesting depth tracked by the structure check
+    constexpr static std::size_t max_depth = 1024;
+
+private:
+    std::string buf;
+
+    std::size_t depth = 0;
+    // no separator before the next value or key
+    bool first = true;
+    // a key was written and its value is due
+    bool after_key = false;
+
+    // bit set when the container at that depth is an object, only when checked
+    std::uint64_t objects[checked ? max_depth / 64 : 1] = {};
+    bool rooted = false;
+
+public:
+    basic_json_writer() = default;
+
+    basic_json_writer& begin_object()
+    {
+        open(true);
+        buf.push_back('{');
+        return *this;
+    }
+
+    basic_json_writer& end_object()
+    {
+        close(true);
+        buf.push_back('}');
+        return *this;
+    }
+
+    basic_json_writer& begin_array()
+    {
+        open(false);
+        buf.push_back('[');
+        return *this;
+    }
+
+    basic_json_writer& end_array()
+    {
+        close(false);
+        buf.push_back(']');
+        return *this;
+    }
+
+    basic_json_writer& key(std::string_view name)
+    {
+        prefix_key();
+        buf.push_back('\"');
+        string(name);
+        buf.append("\": ");
+        return *this;
+    }
+
+    template <std::size_t N>
+    basic_json_writer& key(literal_key<N> const& name)
+    {
+        prefix_key();
+        buf.append(name.view());
+        return *this;
+    }
+
+    /**
+     * value accepts null, booleans, numbers and anything convertible to string_view
+     * integers are written exactly and doubles in their shortest round-trip form,
+     * non-finite doubles have no JSON form and become null
+     */
+    template <typename T>
+    basic_json_writer& value(T const& val);
+
+    /**
+     * the root value is complete
+     */
+    bool complete() const noexcept
+    {
+        return depth == 0 && !first;
+    }
+
+    std::string_view view() const noexcept
+    {
+        return buf;
+    }
+
+    std::string& buffer() noexcept
+    {
+        return buf;
+    }
+
+    /**
+     * hand the buffered text to sink and keep the capacity for more
+     * the structure is not reset, so large documents can be flushed in parts
+     */
+    template <typename Sink>
+    void flush(Sink&& sink)
+    {
+        if (!buf.empty())
+            sink(std::string_view(buf));
+        buf.clear();
+    }
+
+    /**
+     * start the next document, the buffer keeps its capacity
+     */
+    void clear() noexcept
+    {
+        buf.clear();
+        depth = 0;
+        first = true;
+        after_key = false;
+        rooted = false;
+    }
+
+private:
+    bool in_object() const noexcept
+    {
+        std::size_t level = depth - 1;
+        return (objects[level / 64] >> (level % 64)) & 1;
+    }
+
+    void check(bool ok) const
+    {
+        if (!ok)
+            throw bad_write();
+    }
+
+    // separator and checks before any value, containers included
+    void prefix_value()
+    {
+        if constexpr (checked) {
+            if (depth == 0)
+                check(!rooted);
+            else
+                check(in_object() == after_key);
+            rooted = true;
+        }
+
+        if (!first && !after_key)
+            buf.append(", ");
+        first = false;
+        after_key = false;
+    }
+
+    void prefix_key()
+    {
+        if constexpr (checked)
+            check(depth != 0 && in_object() && !after_key);
+
+        if (!first)
+            buf.append(", ");
+        after_key = true;
+    }
+
+    void open(bool is_obj)
+    {
+        prefix_value();
+
+        if constexpr (checked) {
+            check(depth < max_depth);
+            auto& bits = objects[depth / 64];
+            auto mask = std::uint64_t(1) << (depth % 64);
+            bits = is_obj ? bits | mask : bits & ~mask;
+        }
+
+        ++depth;
+        first = true;
+    }
+
+    void close(bool is_obj)
+    {
+        if constexpr (checked)
+            check(depth != 0 && in_object() == is_obj && !after_key);
+
+        --depth;
+        first = false;
+    }
+
+    void string(std::string_view src)
+    {
+        char const* it = src.data();
+        char const* end = it + src.size();
+
+        while (true) {
+            auto st = it;
+            it = scan::escaped(it, end);
+            buf.append(st, it);
+            if (it == end)
+                return;
+
+            char esc[6];
+            buf.append(esc, scan::escape(*it++, esc));
+        }
+    }
+};
+
+// the structure check costs a few compares per call, keep it unless profiled
+using json_writer = basic_json_writer<true>;
+using unchecked_json_writer = basic_json_writer<false>;
+
+template <bool Checked>
+template <typename T>
+inline basic_json_writer<Checked>& basic_json_writer<Checked>::value(T const& val)
+{
+    prefix_value();
+
+    if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        buf.append("null");
+    } else if constexpr (std::is_same_v<T, bool>) {
+        buf.append(val ? "true" : "false");
+    } else if constexpr (std::is_integral_v<T>) {
+        char tmp[24];
+        auto ret = std::to_chars(tmp, tmp + sizeof(tmp), val);
+        buf.append(tmp, ret.ptr);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        if (!std::isfinite(val)) {
+            buf.append("null");
+            return *this;
+        }
+        char tmp[32];
+        auto ret = std::to_chars(tmp, tmp + sizeof(tmp), double(val));
+        buf.append(tmp, ret.ptr);
+    } else {
+        static_assert(std::is_convertible_v<T const&, std::string_view>, "mini_json::basic_json_writer::value : invalid type");
+        buf.push_back('\"');
+        string(std::string_view(val));
+        buf.push_back('\"');
+    }
+    return *this;
+}
+
+}; // namespace mini_json
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -14,17 +15,26 @@ class type_array {
 private:
     constexpr static std::size_t length = sizeof...(Types);
 
-    template <std::size_t Index, typename Arr>
-    struct _at;
-
-    template <typename T, typename... Others>
-    struct _at<0, type_array<T, Others...>> {
+    // every type is a base tagged with its index, so at<Index> is one overload
+    // resolution instead of a chain of Index instantiations
+    template <std::size_t Index, typename T>
+    struct _slot {
         using type = T;
     };
 
-    template <std::size_t Index, typename T, typename... Others>
-    struct _at<Index, type_array<T, Others...>> {
-        using type = typename _at<Index - 1, type_array<Others...>>::type;
+    template <typename Seq>
+    struct _slots;
+
+    template <std::size_t... Index>
+    struct _slots<std::index_sequence<Index...>> : _slot<Index, Types>... {
+    };
+
+    template <std::size_t Index, typename T>
+    static _slot<Index, T> _select(_slot<Index, T> const&);
+
+    template <std::size_t Index>
+    struct _at {
+        using type = typename decltype(_select<Index>(_slots<std::index_sequence_for<Types...>>()))::type;
     };
 
     template <template <typename...> typename T>
@@ -32,13 +42,29 @@ private:
         using type = T<Types...>;
     };
 
+    template <typename Type>
+    constexpr static std::size_t _index() noexcept
+    {
+        constexpr bool same[] = { std::is_same_v<Type, Types>..., false };
+        std::size_t pos = 0;
+        while (pos < length && !same[pos])
+            ++pos;
+        return pos;
+    }
+
+    template <template <typename, std::size_t> typename Func, std::size_t... Index>
+    constexpr static auto _table(std::index_sequence<Index...>) noexcept
+    {
+        return std::array { Func<Types, Index>::value... };
+    }
+
 public:
     // type of self
     using self = type_array<Types...>;
 
     // at is used to use a type at Pos in an array
     template <std::size_t Index>
-    using at = typename _at<Index, self>::type;
+    using at = typename _at<Index>::type;
 
     // len will return the number of types in an array
     constexpr static std::size_t len() noexcept
@@ -58,59 +84,51 @@ public:
     using forward = typename _forward<T>::type;
 
     // find will return Index associated with the given type or assert failed
-    template <typename Type, std::size_t Pos = 0>
+    template <typename Type>
     constexpr static std::size_t find() noexcept
     {
-        constexpr bool ret = cmp<Type, Pos>();
-
-        if constexpr (ret)
-            return Pos;
-
-        if constexpr (Pos + 1 < length)
-            return find<Type, Pos + 1>();
-
-        if constexpr (Pos == length - 1)
-            static_assert(ret, "the given type not exists");
+        constexpr std::size_t ret = _index<Type>();
+        static_assert(ret < length, "the given type not exists");
+        return ret;
     }
 
     // find_if will return an optional
-    template <typename Type, std::size_t Pos = 0>
+    template <typename Type>
     constexpr static std::optional<std::size_t> find_if() noexcept
     {
-        constexpr bool ret = cmp<Type, Pos>();
-
-        if constexpr (ret)
-            return Pos;
-
-        if constexpr (!ret && Pos + 1 < length)
-            return find_if<Type, Pos + 1>();
-
-        if constexpr (!ret && Pos == length - 1)
+        constexpr std::size_t ret = _index<Type>();
+        if constexpr (ret < length)
+            return ret;
+        else
             return std::nullopt;
     }
 
     // for_each is used to traverse all types in an array and perform some actions
     // Func only receive the current type in array
-    template <template <typename> typename Func, std::size_t Pos = 0, typename... Args>
+    template <template <typename> typename Func, typename... Args>
     constexpr static void for_each(Args&&... args)
     {
-        if constexpr (Pos < length)
-            std::invoke(Func<at<Pos>>(), std::forward<Args>(args)...);
-
-        if constexpr (Pos + 1 < length)
-            for_each<Func, Pos + 1>(std::forward<Args>(args)...);
+        (std::invoke(Func<Types>(), args...), ...);
     }
 
     // Func receive both the current type and index in array
-    template <template <typename, std::size_t> typename Func, std::size_t Pos = 0, typename... Args>
+    template <template <typename, std::size_t> typename Func, typename... Args>
     constexpr static void for_each(Args&&... args)
     {
-        if constexpr (Pos < length)
-            std::invoke(Func<at<Pos>, Pos>(), std::forward<Args>(args)...);
+        for_each_indexed<Func>(std::index_sequence_for<Types...>(), args...);
+    }
+
+    // table collects Func<Type, Index>::value of every type into a constexpr array
+    // indexed like the types, so a runtime index dispatches with one lookup
+    template <template <typename, std::size_t> typename Func>
+    constexpr static auto table = _table<Func>(std::index_sequence_for<Types...>());
 
-        if constexpr (Pos + 1 < length)
-            for_each<Func, Pos + 1>(std::forward<Args>(args)...);
+private:
+    template <template <typename, std::size_t> typename Func, std::size_t... Index, typename... Args>
+    constexpr static void for_each_indexed(std::index_sequence<Index...>, Args&... args)
+    {
+        (std::invoke(Func<Types, Index>(), args...), ...);
     }
 };
 
-};
\ No newline at end of file
+};
@@ -30,6 +30,13 @@ private:
         using type = T<Types...>;
     };
 
+    // adapts a Func keyed by Enum to the index based helpers of type_array
+    template <template <typename, Enum> typename Func>
+    struct _keyed {
+        template <typename T, std::size_t Pos>
+        using type = Func<T, static_cast<Enum>(Pos)>;
+    };
+
 public:
     // at is used to get the type at Pos in a umap
     template <Enum Key>
@@ -53,168 +60,46 @@ public:
     using forward = typename _forward<T>::type;
 
     // find will return Key associated with the given type or assert failed
-    template <typename Type, std::size_t Pos = 0>
+    template <typename Type>
     constexpr static Enum find() noexcept
     {
-        constexpr bool ret = cmp<Type, static_cast<Enum>(Pos)>();
-
-        if constexpr (ret)
-            return static_cast<Enum>(Pos);
-
-        if constexpr (!ret && Pos + 1 < length)
-            return find<Type, Pos + 1>();
-
-        if constexpr (Pos == length - 1)
-            static_assert(ret, "the given type not exists");
+        return static_cast<Enum>(array::template find<Type>());
     }
 
     // find_if will return an optional
-    template <typename Type, std::size_t Pos = 0>
+    template <typename Type>
     constexpr static std::optional<Enum> find_if() noexcept
     {
-        constexpr bool ret = cmp<Type, static_cast<Enum>(Pos)>();
-
-        if constexpr (ret)
-            return static_cast<Enum>(Pos);
-
-        if constexpr (!ret && Pos + 1 < length)
-            return find_if<Type, Pos + 1>();
-
-        if constexpr (!ret && Pos == length - 1)
+        if constexpr (constexpr auto ret = array::template find_if<Type>(); ret)
+            return static_cast<Enum>(*ret);
+        else
             return std::nullopt;
     }
 
     // for_each is used to traverse all types in an array and perform some actions
     // Func only receive the current type in array
-    template <template <typename> typename Func, std::size_t Pos = 0, typename... Args>
+    template <template <typename> typename Func, typename... Args>
     constexpr static void for_each(Args&&... args)
     {
-        constexpr Enum key = static_cast<Enum>(Pos);
-
-        if constexpr (Pos < length)
-            std::invoke(Func<at<key>>(), std::forward<Args>(args)...);
-
-        if constexpr (Pos + 1 < length)
-            for_each<Func, Pos + 1>(std::forward<Args>(args)...);
+        array::template for_each<Func>(args...);
     }
 
     // Func receive both the current type and index in array
-    template <template <typename, Enum> typename Func, std::size_t Pos = 0, typename... Args>
+    template <template <typename, Enum> typename Func, typename... Args>
     constexpr static void for_each(Args&&... args)
     {
-        constexpr Enum key = static_cast<Enum>(Pos);
-
-        if constexpr (Pos < length)
-            std::invoke(Func<at<key>, key>(), std::forward<Args>(args)...);
-
-        if constexpr (Pos + 1 < length)
-            for_each<Func, Pos + 1>(std::forward<Args>(args)...);
+        array::template for_each<_keyed<Func>::template type>(args...);
     }
+
+    // table collects Func<Type, Key>::value of every type into a constexpr array
+    // indexed by the keys, see type_array::table
+    template <template <typename, Enum> typename Func>
+    constexpr static auto table = array::template table<_keyed<Func>::template type>;
 };
 
 // type_umap also accept a type_array as its types pack
 template <typename Enum, typename... Types>
-class type_umap<Enum, type_array<Types...>> {
-
-public:
-    // preserve type info of map and inner
-    using self = type_umap<Enum, Types...>;
-    using array = type_array<Types...>;
-    using key = Enum;
-
-private:
-    constexpr static std::size_t length = array::len();
-
-    template <Enum Key>
-    struct _at {
-        using type = typename array::template at<static_cast<std::size_t>(Key)>;
-    };
-
-    template <template <typename...> typename T>
-    struct _forward {
-        using type = T<Types...>;
-    };
-
-public:
-    // at is used to get the type at Pos in a umap
-    template <Enum Key>
-    using at = typename _at<Key>::type;
-
-    // len will return the number of types
-    constexpr static std::size_t len() noexcept
-    {
-        return length;
-    }
-
-    // cmp can be used to compare a given type with the type associated with Key
-    template <typename T, Enum Key>
-    constexpr static bool cmp() noexcept
-    {
-        return std::is_same_v<at<Key>, T>;
-    }
-
-    // forward can forward all types in umap to any suitable templates
-    template <template <typename...> typename T>
-    using forward = typename _forward<T>::type;
-
-    // find will return Key associated with the given type or assert failed
-    template <typename Type, std::size_t Pos = 0>
-    constexpr static Enum find() noexcept
-    {
-        constexpr bool ret = cmp<Type, static_cast<Enum>(Pos)>();
-
-        if constexpr (ret)
-            return static_cast<Enum>(Pos);
-
-        if constexpr (!ret && Pos + 1 < length)
-            return find<Type, Pos + 1>();
-
-        if constexpr (Pos == length - 1)
-            static_assert(ret, "the given type not exists");
-    }
-
-    // find_if will return an optional
-    template <typename Type, std::size_t Pos = 0>
-    constexpr static std::optional<Enum> find_if() noexcept
-    {
-        constexpr bool ret = cmp<Type, static_cast<Enum>(Pos)>();
-
-        if constexpr (ret)
-            return static_cast<Enum>(Pos);
-
-        if constexpr (!ret && Pos + 1 < length)
-            return find_if<Type, Pos + 1>();
-
-        if constexpr (!ret && Pos == length - 1)
-            return std::nullopt;
-    }
-
-    // for_each is used to traverse all types in an array and perform some actions
-    // Func only receive the current type in array
-    template <template <typename> typename Func, std::size_t Pos = 0, typename... Args>
-    constexpr static void for_each(Args&&... args)
-    {
-        constexpr Enum key = static_cast<Enum>(Pos);
-
-        if constexpr (Pos < length)
-            std::invoke(Func<at<key>>(), std::forward<Args>(args)...);
-
-        if constexpr (Pos + 1 < length)
-            for_each<Func, Pos + 1>(std::forward<Args>(args)...);
-    }
-
-    // Func receive both the current type and index in array
-    template <template <typename, Enum> typename Func, std::size_t Pos = 0, typename... Args>
-    constexpr static void for_each(Args&&... args)
-    {
-        constexpr Enum key = static_cast<Enum>(Pos);
-
-        if constexpr (Pos < length)
-            std::invoke(Func<at<key>, key>(), std::forward<Args>(args)...);
-
-        if constexpr (Pos + 1 < length)
-            for_each<Func, Pos + 1>(std::forward<Args>(args)...);
-    }
+class type_umap<Enum, type_array<Types...>> : public type_umap<Enum, Types...> {
 };
 
-};
\ No newline at end of file
+};
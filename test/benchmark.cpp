@@ -1,30 +1,518 @@
-#include <catch2/catch_test_macros.hpp>
-#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <mini_json/json.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
-#include <mini_json/json.hpp>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace json = mini_json;
 
+/**
+ * every allocation of the process goes through these counters
+ * so that the benchmark can report allocations per document
+ */
+static std::size_t alloc_count = 0;
+
+void* operator new(std::size_t size)
+{
+    ++alloc_count;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
 
-TEST_CASE("json test", "[benchmark]")
+void operator delete(void* ptr, std::size_t) noexcept
 {
-    std::ifstream fs("../test/demo/test2.json");
-    if (!fs.is_open())
-        throw std::runtime_error("Can't open file");
+    std::free(ptr);
+}
 
-    std::string con { std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>() };
-    json::json obj(std::move(con));
+namespace {
 
-    BENCHMARK("test json parse")
+using arr_t = std::vector<json::node>;
+using obj_t = std::unordered_map<std::string, json::node>;
+
+/**
+ * splitmix64 keeps the corpora identical across platforms and standard libraries
+ * (std distributions are implementation defined)
+ */
+class rng {
+    std::uint64_t state;
+
+public:
+    explicit rng(std::uint64_t seed)
+        : state(seed)
     {
-        auto ret = obj.parse();
-        return true;
-    };
-    
-    BENCHMARK("test json stringify")
+    }
+
+    std::uint64_t next()
     {
-        auto ret = obj.str();
-        return true;
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    std::size_t below(std::size_t bound)
+    {
+        return static_cast<std::size_t>(next() % bound);
+    }
+};
+
+struct corpus {
+    std::string name;
+    // every document is parsed on its own, NDJSON has one document per line
+    std::vector<std::string> docs;
+    std::size_t bytes = 0;
+};
+
+corpus make_corpus(std::string name, std::vector<std::string> docs)
+{
+    corpus ret { std::move(name), std::move(docs) };
+    for (auto const& doc : ret.docs)
+        ret.bytes += doc.size();
+    return ret;
+}
+
+std::string gen_number(rng& r)
+{
+    switch (r.below(4)) {
+    case 0:
+        return std::to_string(static_cast<long long>(r.next() >> 12) - (1ll << 50));
+    case 1:
+        return std::to_string(r.below(100000));
+    case 2:
+        return std::to_string(r.below(1000000)) + "." + std::to_string(r.below(1000000));
+    default:
+        return std::to_string(r.below(1000)) + "." + std::to_string(r.below(1000))
+            + "e" + (r.below(2) ? "-" : "") + std::to_string(r.below(300));
+    }
+}
+
+std::string gen_string(rng& r)
+{
+    static char const* const pieces[] = {
+        "lorem", "ipsum", " ", "\\n", "\\\"", "\\\\", "\\t", "\\u00e9",
+        "\\u4e2d", "\\u0041", "caf\xc3\xa9", "\xe4\xb8\xad\xe6\x96\x87", "\xf0\x9f\x98\x80",
+        "data", "value", "/", "\\/",
     };
-}
\ No newline at end of file
+
+    std::string ret = "\"";
+    for (std::size_t i = 0, n = 2 + r.below(24); i < n; i++)
+        ret += pieces[r.below(sizeof(pieces) / sizeof(*pieces))];
+    return ret + "\"";
+}
+
+std::string gen_record(rng& r, std::size_t id)
+{
+    std::string ret = "{\"id\": " + std::to_string(id);
+    ret += ", \"name\": " + gen_string(r);
+    ret += ", \"score\": " + gen_number(r);
+    ret += ", \"active\": " + std::string(r.below(2) ? "true" : "false");
+    ret += ", \"parent\": null";
+    ret += ", \"tags\": [" + gen_string(r) + ", " + gen_string(r) + "]";
+    ret += ", \"pos\": {\"x\": " + gen_number(r) + ", \"y\": " + gen_number(r) + "}}";
+    return ret;
+}
+
+corpus number_heavy()
+{
+    rng r(1);
+    std::string doc = "[";
+    for (std::size_t i = 0; i < 20000; i++) {
+        if (i)
+            doc += ", ";
+        if (i % 8 == 7)
+            doc += "[" + gen_number(r) + ", " + gen_number(r) + "]";
+        else
+            doc += gen_number(r);
+    }
+    return make_corpus("number", { doc + "]" });
+}
+
+corpus string_heavy()
+{
+    rng r(2);
+    std::string doc = "[";
+    for (std::size_t i = 0; i < 8000; i++)
+        doc += (i ? ", " : "") + gen_string(r);
+    return make_corpus("string", { doc + "]" });
+}
+
+corpus deep_nesting()
+{
+    // stays below the default depth limit of the parser
+    constexpr std::size_t depth = 1000;
+    rng r(3);
+    std::vector<std::string> docs;
+
+    for (std::size_t n = 0; n < 32; n++) {
+        std::string doc;
+        for (std::size_t i = 0; i < depth; i++)
+            doc += (i % 2) ? "[" : "{\"k\": ";
+        doc += gen_number(r);
+        for (std::size_t i = depth; i-- > 0;)
+            doc += (i % 2) ? "]" : "}";
+        docs.push_back(std::move(doc));
+    }
+    return make_corpus("deep", std::move(docs));
+}
+
+corpus wide_object()
+{
+    rng r(4);
+    std::string doc = "{";
+    for (std::size_t i = 0; i < 5000; i++) {
+        doc += (i ? ", \"field_" : "\"field_") + std::to_string(i) + "\": ";
+        switch (r.below(4)) {
+        case 0:
+            doc += gen_number(r);
+            break;
+        case 1:
+            doc += gen_string(r);
+            break;
+        case 2:
+            doc += r.below(2) ? "true" : "null";
+            break;
+        default:
+            doc += "[" + gen_number(r) + ", " + gen_string(r) + "]";
+            break;
+        }
+    }
+    return make_corpus("wide", { doc + "}" });
+}
+
+corpus ndjson()
+{
+    rng r(5);
+    std::vector<std::string> docs;
+    for (std::size_t i = 0; i < 2000; i++)
+        docs.push_back(gen_record(r, i));
+    return make_corpus("ndjson", std::move(docs));
+}
+
+std::size_t count_nodes(json::node const& mnode)
+{
+    std::size_t ret = 1;
+    switch (mnode.type()) {
+    case json::node::data_k::array:
+        for (auto const& sub : mnode.get<arr_t>())
+            ret += count_nodes(sub);
+        break;
+
+    case json::node::data_k::object:
+        for (auto const& [key, sub] : mnode.get<obj_t>())
+            ret += count_nodes(sub);
+        break;
+
+    // every packed number counts like the node it replaces
+    case json::node::data_k::packed:
+        ret += mnode.get<std::vector<double>>().size();
+        break;
+
+    default:
+        break;
+    }
+    return ret;
+}
+
+/**
+ * lookup walks every container of the tree by key or index
+ * which is the access pattern of typical consumers
+ */
+std::size_t lookup(json::node const& mnode)
+{
+    std::size_t ret = 0;
+    switch (mnode.type()) {
+    case json::node::data_k::array: {
+        auto const& arr = mnode.get<arr_t>();
+        for (std::size_t i = 0; i < arr.size(); i++)
+            ret += 1 + lookup(arr[i]);
+        break;
+    }
+
+    case json::node::data_k::object: {
+        auto const& obj = mnode.get<obj_t>();
+        for (auto const& [key, sub] : obj)
+            ret += 1 + lookup(obj.at(key));
+        break;
+    }
+
+    // packed elements are leaves, reached by index like array elements
+    case json::node::data_k::packed:
+        ret += mnode.get<std::vector<double>>().size();
+        break;
+
+    default:
+        break;
+    }
+    return ret;
+}
+
+struct result {
+    double seconds = 0;  // best time of one pass over the corpus
+    double allocs = 0;   // allocations per document
+};
+
+/**
+ * run the task until min_time elapsed and keep the fastest pass
+ */
+result measure(std::size_t docs, double min_time, std::function<void()> const& task)
+{
+    using clock = std::chrono::steady_clock;
+    result ret { 1e30, 0 };
+
+    std::size_t before = alloc_count;
+    task();
+    ret.allocs = double(alloc_count - before) / double(docs);
+
+    double total = 0;
+    for (std::size_t runs = 0; total < min_time || runs < 3; runs++) {
+        auto st = clock::now();
+        task();
+        double sec = std::chrono::duration<double>(clock::now() - st).count();
+        ret.seconds = std::min(ret.seconds, sec);
+        total += sec;
+    }
+    return ret;
+}
+
+json::node* parse_or_die(json::json& obj, std::string_view doc, corpus const& cor)
+{
+    auto ret = obj.parse(doc);
+    if (!ret) {
+        std::fprintf(stderr, "failed to parse corpus %s\n", cor.name.c_str());
+        std::exit(2);
+    }
+    return ret;
+}
+
+struct options {
+    double min_time = 0.3;
+    double threshold = 10.0;
+    std::string save;
+    std::string compare;
+    std::string filter;
+};
+
+void usage()
+{
+    std::puts("usage: bench [--time SEC] [--filter NAME] [--save FILE] [--compare FILE] [--threshold PCT]");
+    std::puts("  --save     write bytes/s of every measurement to FILE");
+    std::puts("  --compare  compare against a file written by --save, exit 1 on regressions");
+}
+
+options parse_args(int argc, char** argv)
+{
+    options ret;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> char const* {
+            if (i + 1 >= argc) {
+                usage();
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--time")
+            ret.min_time = std::atof(value());
+        else if (arg == "--threshold")
+            ret.threshold = std::atof(value());
+        else if (arg == "--save")
+            ret.save = value();
+        else if (arg == "--compare")
+            ret.compare = value();
+        else if (arg == "--filter")
+            ret.filter = value();
+        else {
+            usage();
+            std::exit(arg == "--help" ? 0 : 2);
+        }
+    }
+    return ret;
+}
+
+std::map<std::string, double> load_baseline(std::string const& path)
+{
+    std::map<std::string, double> ret;
+    std::ifstream fs(path);
+    if (!fs.is_open()) {
+        std::fprintf(stderr, "can't open baseline %s\n", path.c_str());
+        std::exit(2);
+    }
+
+    std::string key;
+    double value;
+    while (fs >> key >> value)
+        ret[key] = value;
+    return ret;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto opts = parse_args(argc, argv);
+
+    std::vector<corpus> corpora;
+    corpora.push_back(number_heavy());
+    corpora.push_back(string_heavy());
+    corpora.push_back(deep_nesting());
+    corpora.push_back(wide_object());
+    corpora.push_back(ndjson());
+
+    // key is "<corpus>.<operation>", value is bytes per second
+    std::map<std::string, double> current;
+
+    std::printf("%-8s %-10s %10s %10s %12s %12s\n",
+        "corpus", "operation", "size(KB)", "MB/s", "Mnodes/s", "allocs/doc");
+
+    for (auto const& cor : corpora) {
+        if (!opts.filter.empty() && cor.name != opts.filter)
+            continue;
+
+        // a parsed copy of every document for the measurements after parsing
+        std::vector<json::json> parsed;
+        std::vector<json::node*> roots;
+        parsed.reserve(cor.docs.size());
+        std::size_t nodes = 0;
+        for (auto const& doc : cor.docs) {
+            roots.push_back(parse_or_die(parsed.emplace_back(), doc, cor));
+            nodes += count_nodes(*roots.back());
+        }
+
+        std::size_t out_bytes = 0;
+        for (auto& obj : parsed)
+            out_bytes += obj.str()->size();
+
+        // one warm parser is reused for every document, like a request handler
+        json::json parser;
+        auto parse = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const& doc : cor.docs)
+                parse_or_die(parser, doc, cor);
+        });
+
+        // six fields survive in the wide corpus, other objects are skipped entirely
+        json::json projected;
+        projected.project({ { "field_0" }, { "field_1" }, { "field_2" }, { "field_3" }, { "field_4" }, { "field_5" } });
+        auto project = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const& doc : cor.docs)
+                parse_or_die(projected, doc, cor);
+        });
+
+        // arrays of numbers become one vector<double> each
+        json::json packer;
+        packer.pack_numbers(true);
+        auto packed = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const& doc : cor.docs)
+                parse_or_die(packer, doc, cor);
+        });
+
+        // numbers and escaped strings keep their text until read
+        json::json deferred;
+        deferred.lazy(true);
+        auto lazy = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const& doc : cor.docs)
+                parse_or_die(deferred, doc, cor);
+        });
+
+        auto stringify = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto& obj : parsed)
+                obj.str();
+        });
+
+        json::json second;
+        auto round_trip = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const& doc : cor.docs) {
+                parse_or_die(parser, doc, cor);
+                parse_or_die(second, *parser.str(), cor);
+            }
+        });
+
+        std::size_t hits = 0;
+        auto find = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const* root : roots)
+                hits += lookup(*root);
+        });
+
+        // deep comparison of unfrozen copies, every node is visited
+        std::vector<json::node> copies;
+        for (auto const* root : roots)
+            copies.push_back(*root);
+        std::size_t digest = 0;
+        auto equal = measure(cor.docs.size(), opts.min_time, [&] {
+            for (std::size_t i = 0; i < roots.size(); i++)
+                digest += (*roots[i] == copies[i]) + roots[i]->hash();
+        });
+
+        auto validate = measure(cor.docs.size(), opts.min_time, [&] {
+            for (auto const& doc : cor.docs)
+                if (!json::json::validate(doc)) {
+                    std::fprintf(stderr, "failed to validate corpus %s\n", cor.name.c_str());
+                    std::exit(2);
+                }
+        });
+
+        auto report = [&](char const* op, result const& res, std::size_t bytes) {
+            double bps = double(bytes) / res.seconds;
+            double nps = double(nodes) / res.seconds;
+            std::printf("%-8s %-10s %10.1f %10.2f %12.2f %12.1f\n", cor.name.c_str(), op,
+                double(bytes) / 1024, bps / 1e6, nps / 1e6, res.allocs);
+            current[cor.name + "." + op] = bps;
+        };
+
+        report("parse", parse, cor.bytes);
+        report("project", project, cor.bytes);
+        report("packed", packed, cor.bytes);
+        report("lazy", lazy, cor.bytes);
+        report("stringify", stringify, out_bytes);
+        report("roundtrip", round_trip, cor.bytes + out_bytes);
+        report("lookup", find, cor.bytes);
+        report("validate", validate, cor.bytes);
+        report("equal", equal, cor.bytes);
+
+        if (digest == 0)
+            std::printf("%-8s equal hashed nothing\n", cor.name.c_str());
+        if (hits == 0)
+            std::printf("%-8s lookup found no containers\n", cor.name.c_str());
+    }
+
+    if (!opts.save.empty()) {
+        std::ofstream fs(opts.save);
+        for (auto const& [key, value] : current)
+            fs << key << ' ' << value << '\n';
+    }
+
+    int status = 0;
+    if (!opts.compare.empty()) {
+        std::printf("\n%-20s %12s %12s %9s\n", "benchmark", "base MB/s", "now MB/s", "change");
+        for (auto const& [key, base] : load_baseline(opts.compare)) {
+            auto it = current.find(key);
+            if (it == current.end())
+                continue;
+
+            double change = (it->second - base) / base * 100;
+            bool regressed = change < -opts.threshold;
+            std::printf("%-20s %12.2f %12.2f %+8.1f%%%s\n", key.c_str(), base / 1e6,
+                it->second / 1e6, change, regressed ? "  REGRESSION" : "");
+            if (regressed)
+                status = 1;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <mini_json/json.hpp>
+#include <mini_json/writer.hpp>
+#include <new>
+#include <string>
+
+namespace json = mini_json;
+
+/**
+ * count every allocation of the test executable
+ * tests read the counter around the code they audit
+ * atomic, since other tests of this executable run worker threads
+ */
+static std::atomic<std::size_t> alloc_count { 0 };
+
+void* operator new(std::size_t size)
+{
+    ++alloc_count;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+TEST_CASE("test json parse allocations", "[alloc]")
+{
+    std::ifstream fs("../test/demo/test1.json");
+    if (!fs.is_open())
+        throw std::runtime_error("can't open file");
+    std::string con { std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>() };
+
+    json::json parser;
+    REQUIRE(parser.parse(con));
+    REQUIRE(parser.str());
+
+    // counters are read before any assertion, which allocates itself
+    std::size_t before = alloc_count;
+    bool parsed = parser.parse(con);
+    std::size_t parse_allocs = alloc_count - before;
+
+    before = alloc_count;
+    bool str = parser.str();
+    std::size_t str_allocs = alloc_count - before;
+
+    // a warm parser only allocates for the tree itself:
+    // 6 objects with a bucket array and one block per member (15),
+    // 1 array and 3 strings longer than the small string buffer
+    REQUIRE(parsed);
+    REQUIRE(parse_allocs <= 6 + 15 + 1 + 3);
+
+    // a warm output buffer does not allocate at all
+    REQUIRE(str);
+    REQUIRE(str_allocs == 0);
+}
+
+TEST_CASE("test node vector growth moves", "[alloc]")
+{
+    std::vector<json::node> arr;
+    arr.emplace_back(std::vector<json::node>(64, json::node("a string beyond small buffer")));
+
+    std::size_t before = alloc_count;
+    for (std::size_t i = 0; i < 16; i++)
+        arr.emplace_back();
+    std::size_t allocs = alloc_count - before;
+
+    // only the vector itself reallocates, nested nodes are moved
+    REQUIRE(allocs <= 5);
+}
+
+TEST_CASE("test json writer allocations", "[alloc]")
+{
+    constexpr json::literal_key id("id");
+    json::json_writer writer;
+    std::string name = "a name well beyond the small string buffer";
+
+    auto write = [&] {
+        writer.clear();
+        writer.begin_array();
+        for (int i = 0; i < 100; i++)
+            writer.begin_object().key(id).value(i).key(name).value(name).key("score").value(i * 0.5).end_object();
+        writer.end_array();
+    };
+
+    write();
+    std::size_t before = alloc_count;
+    write();
+    std::size_t allocs = alloc_count - before;
+
+    REQUIRE(writer.complete());
+    REQUIRE(allocs == 0);
+}
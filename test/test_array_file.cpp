@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <mini_json/array_file.hpp>
+#include <string>
+#include <unordered_map>
+
+namespace json = mini_json;
+
+static std::string write_file(std::string const& name, std::string const& text)
+{
+    std::ofstream fs(name, std::ios::binary);
+    fs << text;
+    return name;
+}
+
+TEST_CASE("test array file elements", "[array_file]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+
+    std::string text = "[\n";
+    double expect = 0;
+    for (int i = 0; i < 1000; i++) {
+        text += (i ? ",\n" : "") + std::string("{\"id\": ") + std::to_string(i) + ", \"s\": \"a,]\\\"}\"}";
+        expect += i;
+    }
+    text += "\n]\n";
+    auto path = write_file("array_file_test.json", text);
+
+    // small chunks split elements, strings and escapes everywhere
+    for (std::size_t prefetch : { 0, 1, 16 }) {
+        json::array_file::options opts;
+        opts.chunk = 7;
+        opts.prefetch = prefetch;
+        json::array_file file(path, opts);
+        REQUIRE(file.is_open());
+
+        double sum = 0;
+        std::size_t count = 0;
+        for (auto& rec : file) {
+            sum += rec.get<Obj>().at("id").as<double>();
+            REQUIRE(rec.get<Obj>().at("s").as<std::string>() == "a,]\"}");
+            ++count;
+        }
+        REQUIRE(count == 1000);
+        REQUIRE(sum == expect);
+        REQUIRE(file.errp() == json::json::error_code::non);
+    }
+
+    // a truncated file yields its complete elements, then an error
+    write_file(path, "[{\"id\": 1}, {\"id\": 2}, {\"id\"");
+    json::array_file::options opts;
+    opts.prefetch = 2;
+    json::array_file broken(path, opts);
+    std::size_t count = 0;
+    for (auto& rec : broken)
+        count += rec.get<Obj>().size();
+    REQUIRE(count == 2);
+    REQUIRE(broken.errp() == json::json::error_code::miss_separator);
+
+    // stopping early joins the prefetch thread
+    write_file(path, text);
+    {
+        json::array_file early(path, opts);
+        REQUIRE(early.begin()->get<Obj>().at("id").as<int>() == 0);
+    }
+
+    // elements count the root array towards the depth limit
+    write_file(path, "[{\"id\": 1}]");
+    for (std::size_t limit : { 1, 2 }) {
+        json::array_file nested(path);
+        nested.parser().depth_limit(limit);
+        json::node rec;
+        REQUIRE(nested.next(rec) == (limit == 2));
+        REQUIRE(nested.errp() == (limit == 2 ? json::json::error_code::non : json::json::error_code::depth_exceeded));
+    }
+
+    // a missing file reads like empty input
+    std::remove(path.c_str());
+    json::array_file missing("no_such_file.json");
+    REQUIRE_FALSE(missing.is_open());
+    REQUIRE(missing.begin() == missing.end());
+    REQUIRE(missing.errp() == json::json::error_code::expect_value);
+}
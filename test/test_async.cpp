@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+#include <mini_json/async.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace json = mini_json;
+
+using Obj = std::unordered_map<std::string, json::node>;
+
+static json::task<double> sum_ids(json::array_reader<json::channel>& reader)
+{
+    double sum = 0;
+    while (auto* elem = co_await reader.next())
+        sum += elem->get<Obj>().at("id").as<double>();
+    co_return sum;
+}
+
+TEST_CASE("test async parse", "[async]")
+{
+    json::json parser;
+    json::channel src;
+
+    auto doc = json::parse_buffered(parser, src);
+    doc.start();
+    REQUIRE_FALSE(doc.done());
+
+    // the task resumes as chunks arrive and finishes when the source ends
+    src.push("{\"a\": [1, ");
+    src.push("2], \"b\": \"x\\");
+    REQUIRE_FALSE(doc.done());
+    src.push("\"y\"}");
+    src.close();
+    REQUIRE(doc.done());
+
+    auto* root = doc.result();
+    REQUIRE(root);
+    REQUIRE(root->get<Obj>().at("b").as<std::string>() == "x\"y");
+}
+
+TEST_CASE("test async array reader", "[async]")
+{
+    // many documents in flight on one thread, each fed byte by byte
+    std::string input = " [{\"id\": 1, \"s\": \"],\\\"[\"}, {\"id\": 2, \"n\": [[], {}]} , {\"id\": 3}] ";
+    std::size_t flights = 50;
+
+    std::vector<json::json> parsers(flights);
+    std::vector<json::channel> sources(flights);
+    std::vector<json::array_reader<json::channel>> readers;
+    std::vector<json::task<double>> tasks;
+    readers.reserve(flights);
+    tasks.reserve(flights);
+
+    for (std::size_t i = 0; i < flights; i++) {
+        readers.emplace_back(parsers[i], sources[i]);
+        tasks.push_back(sum_ids(readers[i]));
+        tasks[i].start();
+    }
+
+    for (char ch : input)
+        for (auto& src : sources)
+            src.push(std::string(1, ch));
+
+    // the closing bracket ends the array while the sources stay open
+    for (std::size_t i = 0; i < flights; i++) {
+        REQUIRE(tasks[i].done());
+        REQUIRE(tasks[i].result() == 6);
+        REQUIRE(readers[i].errp() == json::json::error_code::non);
+    }
+}
+
+TEST_CASE("test async array errors", "[async]")
+{
+    auto run = [](std::string input, std::size_t limit = 1024) {
+        json::json parser;
+        parser.depth_limit(limit);
+        json::channel src;
+        json::array_reader<json::channel> reader(parser, src);
+        auto sum = sum_ids(reader);
+        sum.start();
+        src.push(std::move(input));
+        src.close();
+        REQUIRE(sum.done());
+        return reader.errp();
+    };
+
+    using err = json::json::error_code;
+    REQUIRE(run("[]") == err::non);
+    REQUIRE(run("") == err::expect_value);
+    REQUIRE(run("{\"id\": 1}") == err::invalid_value);
+    REQUIRE(run("[{\"id\": 1}") == err::miss_separator);
+    REQUIRE(run("[{\"id\": 1},]") == err::expect_value);
+    REQUIRE(run("[{\"id\": 1}] 1") == err::root_singular);
+    REQUIRE(run("[{\"id\": 1 2}]") == err::miss_separator);
+
+    // elements count the root array towards the depth limit
+    REQUIRE(run("[{\"id\": 1}]", 2) == err::non);
+    REQUIRE(run("[{\"id\": 1}]", 1) == err::depth_exceeded);
+}
+
+TEST_CASE("test async array schema", "[async]")
+{
+    json::json loader;
+    auto spec = loader.parse(R"({"type": "array", "items": {"type": "object", "required": ["id"]}})");
+    REQUIRE(spec);
+    json::schema rules(*spec);
+
+    auto run = [&](std::string input) {
+        json::json parser;
+        parser.conform(rules);
+        json::channel src;
+        json::array_reader<json::channel> reader(parser, src);
+        auto sum = sum_ids(reader);
+        sum.start();
+        src.push(std::move(input));
+        src.close();
+        REQUIRE(sum.done());
+        return reader.errp();
+    };
+
+    // elements are checked against the items rule, not the root rule
+    using err = json::json::error_code;
+    REQUIRE(run("[{\"id\": 1}, {\"id\": 2}]") == err::non);
+    REQUIRE(run("[{\"id\": 1}, {\"name\": 2}]") == err::schema_violation);
+    REQUIRE(run("[{\"id\": 1}, 2]") == err::schema_violation);
+}
@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+#include <mini_json/batch.hpp>
+#include <future>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace json = mini_json;
+
+TEST_CASE("test batch parse many", "[batch]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+    using err = json::json::error_code;
+
+    // one array large enough to be split, among small documents and errors
+    std::string big = " [";
+    for (int i = 0; i < 5000; i++)
+        big += (i ? ", " : "") + std::string("{\"id\": ") + std::to_string(i) + ", \"s\": \"x,]\"}";
+    big += "] ";
+
+    std::vector<std::string> texts;
+    for (int i = 0; i < 200; i++)
+        texts.push_back("{\"id\": " + std::to_string(i) + "}");
+    texts[7] = "[1, 2";
+    texts[11] = big;
+    texts[13] = "[" + std::string(2000, ' ') + "{\"id\": 1}, {\"id\": 2}, {\"id\": 3 4}, {\"id\": 5}, {\"id\" 6}]";
+
+    json::batch::options opts;
+    opts.threads = 4;
+    opts.split_bytes = 1024;
+    json::batch pool(opts);
+
+    std::vector<std::string_view> docs(texts.begin(), texts.end());
+    for (int round = 0; round < 3; round++) {
+        auto results = pool.parse_many(docs);
+        REQUIRE(results.size() == docs.size());
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+            if (i == 7 || i == 11 || i == 13)
+                continue;
+            REQUIRE(results[i]);
+            REQUIRE(results[i].value.get<Obj>().at("id").as<std::size_t>() == i);
+        }
+
+        REQUIRE(results[7].code == err::miss_separator);
+        REQUIRE(results[7].offset == 5);
+
+        auto& arr = results[11].value.get<Arr>();
+        REQUIRE(arr.size() == 5000);
+        for (std::size_t i = 0; i < arr.size(); i++)
+            REQUIRE(arr[i].get<Obj>().at("id").as<std::size_t>() == i);
+
+        // errors inside split arrays keep their offset in the document
+        json::json whole;
+        REQUIRE_FALSE(whole.parse(texts[13]));
+        REQUIRE(results[13].code == whole.errp());
+        REQUIRE(results[13].offset == whole.errpos());
+    }
+
+    // the async variant and an empty batch
+    auto pending = pool.parse_many_async({ "[true]", "null" });
+    REQUIRE(pending.get()[0].value.get<Arr>()[0].as<bool>());
+    REQUIRE(pool.parse_many({}).empty());
+}
+
+TEST_CASE("test batch shutdown and packing", "[batch]")
+{
+    using Arr = std::vector<json::node>;
+
+    std::vector<std::string> texts;
+    for (int i = 0; i < 1000; i++)
+        texts.push_back("[" + std::to_string(i) + "]");
+    std::vector<std::string_view> docs(texts.begin(), texts.end());
+
+    // jobs still queued when the pool goes away are finished, not dropped
+    std::vector<std::future<std::vector<json::batch::result>>> pending;
+    {
+        json::batch::options opts;
+        opts.threads = 1;
+        json::batch pool(opts);
+        for (int i = 0; i < 8; i++)
+            pending.push_back(pool.parse_many_async(docs));
+    }
+    for (auto& each : pending) {
+        auto results = each.get();
+        REQUIRE(results.size() == docs.size());
+        REQUIRE(results[999].value.get<Arr>()[0].as<int>() == 999);
+    }
+
+    // split arrays are packed like whole ones
+    std::string nums = "[";
+    for (int i = 0; i < 2000; i++)
+        nums += (i ? ", " : "") + std::to_string(i);
+    nums += "]";
+
+    json::batch::options opts;
+    opts.threads = 4;
+    opts.split_bytes = 1024;
+    json::batch pool(opts);
+    pool.configure([](json::json& parser) { parser.pack_numbers(true); });
+
+    auto results = pool.parse_many({ nums, "[1, 2]" });
+    REQUIRE(results[0].value.type() == json::node::data_k::packed);
+    REQUIRE(results[0].value.get<std::vector<double>>().size() == 2000);
+    REQUIRE(results[1].value.type() == json::node::data_k::packed);
+}
+
+TEST_CASE("test batch split matches whole parses", "[batch]")
+{
+    std::string ok = "[";
+    std::string deep = "[";
+    for (int i = 0; i < 2000; i++) {
+        ok += (i ? ", " : "") + std::string("[") + std::to_string(i) + "]";
+        deep += (i ? ", " : "") + std::string(i == 1500 ? "[[1]]" : "[1]");
+    }
+    ok += "]";
+    deep += "]";
+
+    json::batch::options opts;
+    opts.threads = 4;
+    opts.split_bytes = 1024;
+    json::batch pool(opts);
+
+    // split elements are one level deeper, as inside a whole parse
+    for (std::size_t limit : { 0, 1, 2, 3 }) {
+        pool.configure([&](json::json& parser) { parser.depth_limit(limit); });
+        auto results = pool.parse_many({ ok, deep });
+
+        for (std::size_t i = 0; i < 2; i++) {
+            json::json whole;
+            whole.depth_limit(limit);
+            bool parsed = whole.parse(i ? deep : ok) != nullptr;
+            REQUIRE(bool(results[i]) == parsed);
+            REQUIRE(results[i].code == whole.errp());
+            REQUIRE(results[i].offset == whole.errpos());
+        }
+    }
+}
+
+TEST_CASE("test batch schema", "[batch]")
+{
+    using Arr = std::vector<json::node>;
+
+    std::string ok = "[";
+    std::string bad = "[";
+    for (int i = 0; i < 2000; i++) {
+        ok += (i ? ", " : "") + std::string("{\"id\": ") + std::to_string(i) + "}";
+        bad += (i ? ", " : "") + std::string(i == 1500 ? "{\"name\": 1}" : "{\"id\": 1}");
+    }
+    ok += "]";
+    bad += "]";
+
+    json::json loader;
+    auto spec = loader.parse(R"({"type": "array", "items": {"type": "object", "required": ["id"]}})");
+    REQUIRE(spec);
+    json::schema rules(*spec);
+
+    json::batch::options opts;
+    opts.threads = 4;
+    opts.split_bytes = 1024;
+    json::batch pool(opts);
+    pool.configure([&](json::json& parser) { parser.conform(rules); });
+
+    // large arrays are checked against the whole schema, not the root rule per element
+    std::vector<std::string_view> docs = { ok, bad, "{\"id\": 1}" };
+    auto results = pool.parse_many(docs);
+    REQUIRE(results[0]);
+    REQUIRE(results[0].value.get<Arr>().size() == 2000);
+
+    for (std::size_t i = 0; i < docs.size(); i++) {
+        json::json whole;
+        whole.conform(rules);
+        REQUIRE(bool(results[i]) == (whole.parse(docs[i]) != nullptr));
+        REQUIRE(results[i].code == whole.errp());
+        REQUIRE(results[i].offset == whole.errpos());
+    }
+}
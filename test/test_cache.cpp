@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+#include <mini_json/cache.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace json = mini_json;
+
+TEST_CASE("test cache hits and eviction", "[cache]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+
+    json::parse_cache::options opts;
+    opts.capacity = 2;
+    opts.shards = 1;
+    json::parse_cache cache(opts);
+    json::json parser;
+
+    std::string first = "{\"id\": 1}";
+    auto res = cache.parse(parser, first);
+    REQUIRE(res);
+    REQUIRE(cache.stats().misses == 1);
+
+    // a different buffer with the same bytes is a hit
+    std::string again = first;
+    auto hit = cache.parse(parser, again);
+    REQUIRE(hit);
+    REQUIRE(hit.value.frozen());
+    REQUIRE(cache.stats().hits == 1);
+    REQUIRE(hit.value == res.value);
+
+    // copies handed out can be mutated without touching the cache
+    hit.value.get<Obj>()["id"] = 2;
+    REQUIRE(cache.parse(parser, first).value.get<Obj>().at("id").as<int>() == 1);
+    REQUIRE(cache.stats().hits == 2);
+
+    // errors are reported and not kept
+    auto bad = cache.parse(parser, "[1, 2");
+    REQUIRE_FALSE(bad);
+    REQUIRE(bad.code == json::json::error_code::miss_separator);
+    REQUIRE(cache.size() == 1);
+
+    // the least recently used entry goes first
+    cache.parse(parser, "[2]");
+    cache.parse(parser, first);
+    cache.parse(parser, "[3]");
+    REQUIRE(cache.size() == 2);
+    std::size_t misses = cache.stats().misses;
+    cache.parse(parser, first);
+    REQUIRE(cache.stats().misses == misses);
+    cache.parse(parser, "[2]");
+    REQUIRE(cache.stats().misses == misses + 1);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("test cache across threads", "[cache]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+
+    std::vector<std::string> texts;
+    for (int i = 0; i < 50; i++)
+        texts.push_back("{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\", \"b\"]}");
+
+    json::parse_cache cache;
+    std::vector<std::thread> workers;
+    std::vector<int> wrong(4);
+    for (std::size_t t = 0; t < wrong.size(); t++)
+        workers.emplace_back([&, t] {
+            json::json parser;
+            for (int round = 0; round < 20; round++)
+                for (std::size_t i = 0; i < texts.size(); i++) {
+                    auto res = cache.parse(parser, texts[i]);
+                    wrong[t] += !res || res.value.get<Obj>().at("id").as<std::size_t>() != i;
+                }
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto count : wrong)
+        REQUIRE(count == 0);
+    REQUIRE(cache.size() == texts.size());
+    REQUIRE(cache.stats().hits + cache.stats().misses == 4 * 20 * texts.size());
+    REQUIRE(cache.stats().misses >= texts.size());
+}
@@ -1,6 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 #include <fstream>
 #include <mini_json/json.hpp>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace json = mini_json;
 
@@ -20,4 +25,466 @@ TEST_CASE("test json initialize", "[json]")
     auto const& str = *sret;
     std::ofstream ofs("../test/demo/output.json");
     ofs << str;
-}
\ No newline at end of file
+}
+
+TEST_CASE("test json reuse", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    json::json parser;
+
+    auto first = parser.parse("{\"id\": 1, \"name\": \"arthur\"}");
+    REQUIRE(first);
+    REQUIRE(first->get<Obj>().at("name").as<std::string_view>() == "arthur");
+
+    auto second = parser.parse("[1, 2, 3]");
+    REQUIRE(second);
+    REQUIRE(second->get<std::vector<json::node>>().size() == 3);
+    REQUIRE(*parser.str() == "[1.000000, 2.000000, 3.000000]");
+
+    // input is a slice without null terminator
+    std::string_view buffer = "\"abc\"\"def\"";
+    auto third = parser.parse(buffer.substr(5, 5));
+    REQUIRE(third);
+    REQUIRE(third->get<std::string>() == "def");
+
+    REQUIRE_FALSE(parser.parse("[1, 2"));
+    REQUIRE(parser.str() == nullptr);
+    REQUIRE(parser.parse("true"));
+
+    // a repeated key keeps the first value
+    auto dup = parser.parse(R"({"id": 1, "id": 2, "name": "a", "name": {}})");
+    REQUIRE(dup);
+    REQUIRE(dup->get<Obj>().at("id").as<int>() == 1);
+    REQUIRE(dup->get<Obj>().at("name").as<std::string_view>() == "a");
+}
+
+TEST_CASE("test json errors", "[json]")
+{
+    using err = json::json::error_code;
+    json::json parser;
+
+    auto check = [&](std::string_view input, err code) {
+        REQUIRE_FALSE(parser.parse(input));
+        REQUIRE(parser.errp() == code);
+    };
+
+    check("", err::expect_value);
+    check("[1, ", err::expect_value);
+    check("1 2", err::root_singular);
+    check("[1 2]", err::miss_separator);
+    check("{\"a\" 1}", err::miss_separator);
+    check("{a: 1}", err::invalid_key);
+    check("nul", err::invalid_value);
+    check("\"abc", err::invalid_value);
+    check("\"\\x\"", err::invalid_escape);
+    check("\"\\u12\"", err::invalid_escape);
+
+    REQUIRE_FALSE(parser.parse("[1, 2 3]"));
+    REQUIRE(parser.errpos() == 6);
+}
+
+TEST_CASE("test json unicode escape", "[json]")
+{
+    json::json parser;
+    auto ret = parser.parse("\"\\u0041\\u00e9\\u4e2dBEEF\"");
+    REQUIRE(ret);
+    REQUIRE(ret->get<std::string>() == "A\xc3\xa9\xe4\xb8\xad" "BEEF");
+
+    // a surrogate pair is one 4-byte sequence, not two CESU-8 halves
+    ret = parser.parse("[\"\\ud83d\\ude00\", \"caf\xc3\xa9 \xf0\x9f\x98\x80\"]");
+    REQUIRE(ret);
+    REQUIRE(*parser.str() == "[\"\xf0\x9f\x98\x80\", \"caf\xc3\xa9 \xf0\x9f\x98\x80\"]");
+
+    using err = json::json::error_code;
+    auto check = [&](std::string_view input, err code) {
+        REQUIRE_FALSE(parser.parse(input));
+        REQUIRE(parser.errp() == code);
+        REQUIRE(json::json::validate(input).code == code);
+    };
+
+    check("\"\\ud83d\"", err::invalid_escape);
+    check("\"\\ud83d\\u0041\"", err::invalid_escape);
+    check("\"\\ude00\"", err::invalid_escape);
+    check("\"\\u+1F0\"", err::invalid_escape);
+    check("\"\xc3(\"", err::invalid_utf8);
+    check("{\"\xed\xa0\x80\": 1}", err::invalid_utf8);
+    check("\"\xf8\x88\x80\x80\x80\"", err::invalid_utf8);
+    check("\"a\tb\"", err::invalid_value);
+}
+
+TEST_CASE("test json depth limit", "[json]")
+{
+    json::json parser;
+    std::string hostile(1000000, '[');
+    REQUIRE_FALSE(parser.parse(hostile));
+    REQUIRE(parser.errp() == json::json::error_code::depth_exceeded);
+
+    std::size_t depth = 5000;
+    std::string deep = std::string(depth, '[') + "true" + std::string(depth, ']');
+    REQUIRE_FALSE(parser.parse(deep));
+
+    parser.depth_limit(depth);
+    REQUIRE(parser.parse(deep));
+    REQUIRE(*parser.str() == deep);
+
+    // empty containers count like others
+    parser.depth_limit(3);
+    REQUIRE(parser.parse("{\"a\": [1, []], \"b\": {}}"));
+    parser.depth_limit(2);
+    REQUIRE_FALSE(parser.parse("{\"a\": [1, []], \"b\": {}}"));
+    REQUIRE_FALSE(parser.parse("[[[]]]"));
+    REQUIRE_FALSE(parser.parse("{\"a\": [[1]]}"));
+    REQUIRE(parser.parse("[[], {}]"));
+}
+
+TEST_CASE("test json incremental str", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    json::json doc;
+    auto root = doc.parse("{\"a\": {\"x\": [1, 2, 3], \"y\": \"why\"}, \"b\": {\"z\": true}}");
+    REQUIRE(root);
+
+    std::string plain = *doc.str();
+    root->freeze();
+    doc.str_cache(1);
+    REQUIRE(*doc.str() == plain);
+    // the second pass copies the cached root
+    REQUIRE(*doc.str() == plain);
+
+    root->get<Obj>().at("a").get<Obj>().at("y") = "changed";
+    json::json fresh;
+    std::string expect = *doc.str();
+    REQUIRE(fresh.parse(expect));
+    REQUIRE(fresh.parse(expect)->get<Obj>().at("a").get<Obj>().at("y").as<std::string>() == "changed");
+    REQUIRE(fresh.parse(expect)->get<Obj>().at("b").get<Obj>().at("z").as<bool>());
+
+    root->freeze();
+    REQUIRE(*doc.str() == expect);
+    REQUIRE(*doc.str() == expect);
+}
+
+TEST_CASE("test json validate", "[json]")
+{
+    using err = json::json::error_code;
+
+    auto valid = [](std::string_view input) {
+        return bool(json::json::validate(input));
+    };
+
+    auto check = [](std::string_view input, err code, std::size_t offset) {
+        auto ret = json::json::validate(input);
+        REQUIRE(ret.code == code);
+        REQUIRE(ret.offset == offset);
+    };
+
+    REQUIRE(valid("{\"a\": [1, -2.5e+3, true, false, null, \"x\\u00e9\\n\"], \"b\": {}}"));
+    REQUIRE(valid(" [ ] "));
+    REQUIRE(valid("\"caf\xc3\xa9 \xf0\x9f\x98\x80\""));
+    REQUIRE(valid("0"));
+
+    check("", err::expect_value, 0);
+    check("[1, 2", err::miss_separator, 5);
+    check("[1 2]", err::miss_separator, 3);
+    check("{\"a\" 1}", err::miss_separator, 5);
+    check("{a: 1}", err::invalid_key, 1);
+    check("01", err::root_singular, 1);
+    check("[1.]", err::invalid_value, 3);
+    check("[-]", err::invalid_value, 2);
+
+    // parse shares the number grammar, so validate predicts what parses
+    for (std::string_view input : { "[01]", "[1.]", "[-inf]", "[-nan]", "[+1]", "[.5]", "[1e]", "[-0.0e+5]" }) {
+        json::json parser;
+        bool parsed = parser.parse(input);
+        auto ret = json::json::validate(input);
+        REQUIRE(parsed == bool(ret));
+        if (!parsed) {
+            REQUIRE(parser.errp() == ret.code);
+            REQUIRE(parser.errpos() == ret.offset);
+        }
+    }
+    check("[tru]", err::invalid_value, 1);
+    check("\"a\tb\"", err::invalid_value, 2);
+    check("\"\\u12g4\"", err::invalid_escape, 2);
+    check("\"\\q\"", err::invalid_escape, 2);
+    check("\"\xc3\"", err::invalid_utf8, 1);
+    check("\"\xc0\xaf\"", err::invalid_utf8, 1);
+    check("\"\xed\xa0\x80\"", err::invalid_utf8, 1);
+    check("\"\xf4\x90\x80\x80\"", err::invalid_utf8, 1);
+    check("[1,]", err::invalid_value, 3);
+
+    std::string deep = std::string(2000, '[') + std::string(2000, ']');
+    REQUIRE(json::json::validate(deep).code == err::depth_exceeded);
+    REQUIRE(json::json::validate<2000>(deep));
+    REQUIRE(json::json::validate<1999>(deep).code == err::depth_exceeded);
+
+    // every prefix of a valid document is rejected without reading past its end
+    std::string doc = "{\"key\": [\"value with some length\", 12.5, {\"n\": null}]}";
+    for (std::size_t i = 0; i < doc.size(); i++)
+        REQUIRE_FALSE(valid(std::string_view(doc).substr(0, i)));
+}
+
+TEST_CASE("test json projection", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+
+    json::json parser;
+    parser.project({ { "id" }, { "user", "name" }, { "items", "sku" } });
+
+    auto root = parser.parse("{\"id\": 7, \"blob\": {\"x\": [1, \"}]\\\"\", {}]}, \"user\": {\"name\": \"ann\", \"age\": 30},"
+                             " \"items\": [{\"sku\": \"a\", \"qty\": 1}, {\"qty\": 2}], \"tail\": -1.5e3}");
+    REQUIRE(root);
+
+    auto& obj = root->get<Obj>();
+    REQUIRE(obj.size() == 3);
+    REQUIRE(obj.at("id").as<int>() == 7);
+    REQUIRE(obj.at("user").get<Obj>().size() == 1);
+    REQUIRE(obj.at("user").get<Obj>().at("name").as<std::string>() == "ann");
+
+    auto& items = obj.at("items").get<Arr>();
+    REQUIRE(items.size() == 2);
+    REQUIRE(items[0].get<Obj>().size() == 1);
+    REQUIRE(items[0].get<Obj>().at("sku").as<std::string>() == "a");
+    REQUIRE(items[1].get<Obj>().empty());
+
+    // skipped values still need terminated strings and balanced brackets
+    REQUIRE_FALSE(parser.parse("{\"x\": [1, {}"));
+    REQUIRE(parser.errp() == json::json::error_code::invalid_value);
+    REQUIRE_FALSE(parser.parse("{\"x\": \"abc}"));
+    REQUIRE_FALSE(parser.parse("{\"x\": }"));
+    REQUIRE(parser.errp() == json::json::error_code::expect_value);
+
+    // a shorter path keeps the whole subtree
+    parser.project({ { "user" }, { "user", "name" } });
+    REQUIRE(parser.parse("{\"user\": {\"name\": \"ann\", \"age\": 30}, \"id\": 7}")->get<Obj>().at("user").get<Obj>().size() == 2);
+
+    parser.project({});
+    REQUIRE(parser.parse("{\"user\": {}, \"id\": 7}")->get<Obj>().size() == 2);
+}
+
+TEST_CASE("test json schema", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using err = json::json::error_code;
+
+    json::json loader;
+    auto spec = loader.parse(R"({
+        "type": "object",
+        "required": ["id", "tags"],
+        "additionalProperties": false,
+        "properties": {
+            "id": {"type": "integer", "minimum": 1},
+            "name": {"type": ["string", "null"], "maxLength": 3},
+            "kind": {"enum": ["a", "b", [1, 2]]},
+            "tags": {"type": "array", "items": {"type": "string"}},
+            "debug": {"x-ignore": true}
+        }
+    })");
+    REQUIRE(spec);
+
+    json::json parser;
+    parser.conform(json::schema(*spec));
+
+    auto root = parser.parse(R"({"id": 3, "name": "ann", "kind": [1, 2], "tags": [], "debug": {"deep": [1, 2, 3]}})");
+    REQUIRE(root);
+    REQUIRE(root->get<Obj>().size() == 4);
+    REQUIRE(root->get<Obj>().count("debug") == 0);
+    REQUIRE(parser.parse(R"({"tags": ["x"], "name": null, "id": 1e3})"));
+
+    auto violates = [&](std::string_view input, std::size_t offset) {
+        REQUIRE_FALSE(parser.parse(input));
+        REQUIRE(parser.errp() == err::schema_violation);
+        REQUIRE(parser.errpos() == offset);
+    };
+    violates(R"([])", 0);
+    violates(R"({"id": "3", "tags": []})", 7);
+    violates(R"({"id": 1.5, "tags": []})", 7);
+    violates(R"({"id": 0, "tags": []})", 7);
+    violates(R"({"id": 1, "name": "anne", "tags": []})", 18);
+    violates(R"({"id": 1, "kind": "c", "tags": []})", 18);
+    violates(R"({"id": 1, "tags": ["x", 2]})", 24);
+    violates(R"({"id": 1, "tags": [], "other": 1})", 22);
+    violates(R"({"id": 1})", 9);
+    violates(R"({})", 0);
+
+    // grammar errors are still reported as such
+    REQUIRE_FALSE(parser.parse(R"({"id": x})"));
+    REQUIRE(parser.errp() == err::invalid_value);
+
+    REQUIRE_THROWS_AS(json::schema(*loader.parse(R"({"type": "date"})")), json::bad_schema);
+    REQUIRE_THROWS_AS(json::schema(*loader.parse(R"({"items": [{}]})")), json::bad_schema);
+    REQUIRE_THROWS_AS(json::schema(*loader.parse(R"({"minimum": "1"})")), json::bad_schema);
+
+    parser.conform({});
+    REQUIRE(parser.parse(R"([])"));
+}
+
+TEST_CASE("test json lazy values", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+
+    std::string_view input = "[12345678901234567890123, 0.1000000000000000055511151231257827, -2.5e-3,"
+                             " \"plain\", \"tab\\tquote\\\"\\u00e9\\ud83d\\ude00\", {\"k\\n\": 1}]";
+    json::json parser;
+    parser.lazy(true);
+    auto root = parser.parse(input);
+    REQUIRE(root);
+
+    // untouched values are written back verbatim
+    REQUIRE(*parser.str() == input);
+
+    auto const& arr = std::as_const(*root).get<Arr>();
+    REQUIRE(arr[0].type() == json::node::data_k::number);
+    REQUIRE(arr[2].get<double>() == -2.5e-3);
+    REQUIRE(arr[2].as<int>() == 0);
+    REQUIRE(arr[3].get<std::string>() == "plain");
+    REQUIRE(arr[4].type() == json::node::data_k::string);
+    REQUIRE(arr[4].get<std::string>() == "tab\tquote\"\xC3\xA9\xF0\x9F\x98\x80");
+    REQUIRE(arr[5].get<Obj>().count("k\n") == 1);
+    REQUIRE_THROWS_AS(arr[3].get<double>(), json::bad_get);
+
+    // decoded strings are escaped again, numbers keep their text
+    REQUIRE(parser.str()->find("tab\\tquote\\\"\xC3\xA9") != std::string::npos);
+    REQUIRE(parser.str()->find("12345678901234567890123") != std::string::npos);
+
+    // equal to an eager parse
+    json::json eager;
+    REQUIRE(*eager.parse(input) == *root);
+    REQUIRE(eager.parse(input)->hash() == root->hash());
+
+    // mutation replaces the raw value
+    root->get<Arr>()[0].get<double>() += 1;
+    REQUIRE(root->get<Arr>()[0].type() == json::node::data_k::number);
+    REQUIRE(parser.str()->find("12345678901234567890123") == std::string::npos);
+
+    // grammar errors are found without decoding
+    REQUIRE_FALSE(parser.parse("[1.]"));
+    REQUIRE(parser.errp() == json::json::error_code::invalid_value);
+    REQUIRE_FALSE(parser.parse("[\"\\x\"]"));
+    REQUIRE(parser.errp() == json::json::error_code::invalid_escape);
+    REQUIRE_FALSE(parser.parse("[\"\\ud800\"]"));
+    REQUIRE(parser.errp() == json::json::error_code::invalid_escape);
+
+    // lazy mode accepts exactly what an eager parse accepts
+    for (std::string_view text : { "[01]", "[1.]", "[-inf]", "[-nan]", "[.5]", "[1e]", "[-0.0e+5]", "[1E9, -0]" }) {
+        bool lazy_ok = parser.parse(text);
+        bool eager_ok = eager.parse(text);
+        REQUIRE(lazy_ok == eager_ok);
+        REQUIRE(parser.errp() == eager.errp());
+        if (!lazy_ok)
+            REQUIRE(parser.errpos() == eager.errpos());
+    }
+}
+
+TEST_CASE("test json gather", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+
+    std::string blob(1000, 'b');
+    std::string html = std::string(300, 'h') + "\\\"<\\n>\\\"" + std::string(300, 'h');
+    std::string input = "[\"" + blob + "\", \"short\", \"" + html + "\", {\"k\": [1, 2]}, \"" + blob + "\"]";
+
+    json::json doc(input);
+    auto root = doc.parse();
+    REQUIRE(root);
+    std::string flat = *doc.str();
+
+    auto join = [](std::vector<std::string_view> const& parts) {
+        std::string ret;
+        for (auto part : parts)
+            ret.append(part);
+        return ret;
+    };
+
+    auto parts = doc.str_gather();
+    REQUIRE(parts);
+    REQUIRE(join(*parts) == flat);
+    // blobs and the clean runs around the escapes are referenced in place
+    REQUIRE((*parts)[1].data() == root->get<Arr>()[0].get<std::string>().data());
+    std::size_t inplace = 0;
+    for (auto part : *parts)
+        inplace += part.size() >= 256 ? part.size() : 0;
+    REQUIRE(inplace == 2 * 1000 + 2 * 300);
+
+    // cached fragments of frozen subtrees are referenced as well
+    root->freeze();
+    doc.str_cache(16);
+    REQUIRE(*doc.str() == flat);
+    parts = doc.str_gather(4);
+    REQUIRE(join(*parts) == flat);
+    REQUIRE(join(*doc.str_gather(1)) == flat);
+
+    // everything is copied when nothing is long enough
+    REQUIRE(doc.str_gather(100000)->size() == 1);
+    REQUIRE(root->get<Arr>()[3].get<Obj>().size() == 1);
+}
+
+TEST_CASE("test json str size", "[json]")
+{
+    std::string input = "{\"a\\u0001\\\"\": [1e300, -0.5, 123456789012, [], {}, null, true, false],"
+                        " \"s\": \"tab\\t\\u00e9\\/\\\\\", \"o\": {\"x\": [[1, 2], [3]]}}";
+    for (int mode = 0; mode < 4; mode++) {
+        json::json doc;
+        doc.pack_numbers(mode == 1);
+        doc.lazy(mode == 2);
+        auto root = doc.parse(input);
+        REQUIRE(root);
+        if (mode == 2)
+            REQUIRE(std::as_const(*root).get<std::unordered_map<std::string, json::node>>().at("s").as<std::string>().size() == 8);
+        if (mode == 3) {
+            root->freeze();
+            doc.str_cache(1);
+            doc.str();
+        }
+        REQUIRE(doc.str_size() == doc.str()->size());
+    }
+
+    json::json none;
+    REQUIRE(none.str_size() == 0);
+}
+
+TEST_CASE("test json packed numbers", "[json]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+    using Nums = std::vector<double>;
+
+    json::json parser;
+    parser.pack_numbers(true);
+    std::string_view input = "{\"pts\": [1.5, -2, 3e2], \"mixed\": [1, \"a\"], \"empty\": []}";
+    auto root = parser.parse(input);
+    REQUIRE(root);
+
+    auto& obj = root->get<Obj>();
+    auto& pts = obj.at("pts");
+    REQUIRE(pts.type() == json::node::data_k::packed);
+    REQUIRE(pts.get<Nums>() == Nums { 1.5, -2, 300 });
+    REQUIRE(obj.at("mixed").type() == json::node::data_k::array);
+    REQUIRE(obj.at("empty").type() == json::node::data_k::array);
+
+    // const access never converts, conversions and mutable access fall back to nodes
+    REQUIRE_THROWS_AS(std::as_const(pts).get<Arr>(), json::bad_get);
+    REQUIRE(pts.as<Arr>().size() == 3);
+    auto frozen = pts;
+    frozen.freeze();
+    REQUIRE(frozen.get<Nums>().size() == 3);
+    pts.get<Arr>().push_back(4);
+    REQUIRE(pts.type() == json::node::data_k::array);
+    REQUIRE(pts.get<Arr>()[3].as<int>() == 4);
+    REQUIRE(frozen.type() == json::node::data_k::packed);
+
+    // output is the same as for arrays of nodes
+    std::string_view nested = "[[1.5, -2, 3e2], [1, \"a\"], []]";
+    json::json plain;
+    auto unpacked = plain.parse(nested);
+    auto packed = parser.parse(nested);
+    REQUIRE(unpacked);
+    REQUIRE(packed);
+    REQUIRE(*parser.str() == *plain.str());
+
+    // and so are equality and hashing
+    REQUIRE(*packed == *unpacked);
+    REQUIRE(packed->hash() == unpacked->hash());
+}
@@ -4,7 +4,9 @@
 #include <mini_json/node.hpp>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace json = mini_json;
@@ -82,4 +84,192 @@ TEST_CASE("test node object", "[node]")
         REQUIRE(node["name"].get<std::string>() == "arthur");
         REQUIRE(node["age"].as<int>() == 19);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("test node copy on write", "[node]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+
+    Obj inner = { { "port", 80 }, { "hosts", Arr { "a", "b" } } };
+    json::node base(Obj { { "server", inner }, { "name", "conf" } });
+    base.freeze();
+    REQUIRE(base.frozen());
+    REQUIRE(base.type() == json::node::data_k::object);
+
+    // copies share the whole tree
+    json::node copy = base;
+    auto const& cbase = base;
+    auto const& ccopy = copy;
+    REQUIRE(&cbase.get<Obj>() == &ccopy.get<Obj>());
+
+    // mutation clones the path only, siblings stay shared
+    copy.get<Obj>().at("server").get<Obj>().at("port") = 8080;
+    REQUIRE(cbase.get<Obj>().at("server").get<Obj>().at("port").as<int>() == 80);
+    REQUIRE(ccopy.get<Obj>().at("server").get<Obj>().at("port").as<int>() == 8080);
+    REQUIRE(&cbase.get<Obj>().at("name").get<std::string>() == &ccopy.get<Obj>().at("name").get<std::string>());
+    REQUIRE(&cbase.get<Obj>().at("server").get<Obj>().at("hosts").get<Arr>()
+        == &ccopy.get<Obj>().at("server").get<Obj>().at("hosts").get<Arr>());
+    REQUIRE(ccopy.get<Obj>().at("name").as<std::string_view>() == "conf");
+
+    // the last owner takes the value without cloning
+    json::node single(Arr { 1, 2 });
+    single.freeze();
+    auto const* addr = &std::as_const(single).get<Arr>()[0];
+    REQUIRE(&single.get<Arr>()[0] == addr);
+    REQUIRE_FALSE(single.frozen());
+}
+
+TEST_CASE("test node shared snapshot across threads", "[node]")
+{
+    using Arr = std::vector<json::node>;
+
+    Arr items;
+    for (int i = 0; i < 100; i++)
+        items.emplace_back(Arr { i, "item" });
+    json::node snapshot(std::move(items));
+    snapshot.freeze();
+
+    std::vector<std::thread> workers;
+    std::vector<double> sums(4);
+    for (std::size_t t = 0; t < sums.size(); t++)
+        workers.emplace_back([&, t] {
+            for (int round = 0; round < 50; round++) {
+                json::node local = snapshot;
+                local.get<Arr>()[t].get<Arr>()[0] = -1;
+                for (auto const& item : std::as_const(snapshot).get<Arr>())
+                    sums[t] += item.get<Arr>()[0].as<double>();
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto sum : sums)
+        REQUIRE(sum == 50 * 4950);
+}
+
+TEST_CASE("test node equality and hash", "[node]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+
+    REQUIRE(json::node() == json::node(nullptr));
+    REQUIRE(json::node(1) == json::node(1.0));
+    REQUIRE(json::node(0.0).hash() == json::node(-0.0).hash());
+    REQUIRE(json::node(1) != json::node(true));
+    REQUIRE(json::node("1") != json::node(1));
+    REQUIRE(json::node(Arr { 1, 2 }) != json::node(Arr { 2, 1 }));
+    REQUIRE(json::node(Arr { 1, 2 }).hash() != json::node(Arr { 2, 1 }).hash());
+
+    // members are compared whatever order the maps iterate in
+    Obj small, large;
+    large.reserve(1024);
+    for (int i = 0; i < 64; i++) {
+        small.emplace(std::to_string(i), Arr { i, "x" });
+        large.emplace(std::to_string(63 - i), Arr { 63 - i, "x" });
+    }
+    json::node lhs(small), rhs(large);
+    REQUIRE(lhs == rhs);
+    REQUIRE(lhs.hash() == rhs.hash());
+    rhs.get<Obj>()["0"] = 0;
+    REQUIRE(lhs != rhs);
+    REQUIRE(lhs.hash() != rhs.hash());
+
+    // frozen nodes remember their hash until a mutation unshares them
+    lhs.freeze();
+    json::node copy = lhs;
+    REQUIRE(copy == lhs);
+    std::size_t before = lhs.hash();
+    REQUIRE(copy.hash() == before);
+    copy.get<Obj>()["new"] = 1;
+    REQUIRE(copy != lhs);
+    REQUIRE(copy.hash() != before);
+    REQUIRE(lhs.hash() == before);
+
+    std::unordered_map<json::node, int> seen;
+    seen[lhs] = 1;
+    seen[json::node(small)] += 1;
+    REQUIRE(seen.size() == 1);
+    REQUIRE(seen[lhs] == 2);
+}
+
+TEST_CASE("test node memory usage and compact", "[node]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    using Arr = std::vector<json::node>;
+
+    Arr items;
+    items.reserve(1000);
+    for (int i = 0; i < 100; i++) {
+        Obj item;
+        item.reserve(500);
+        item.emplace("name", std::string(40, 'a' + i % 26));
+        item.emplace("id", i);
+        items.push_back(std::move(item));
+    }
+    json::node root(std::move(items));
+    json::node copy = root;
+
+    auto before = root.memory_usage();
+    REQUIRE(before.elements == 100 * sizeof(json::node));
+    REQUIRE(before.slack >= 900 * sizeof(json::node));
+    REQUIRE(before.strings >= 100 * 41);
+
+    root.compact();
+    auto after = root.memory_usage();
+    REQUIRE(root == copy);
+    REQUIRE(after.elements == before.elements);
+    REQUIRE(after.slack == 0);
+    REQUIRE(after.buckets < before.buckets);
+    REQUIRE(after.total() < before.total());
+
+    // shared values are counted once
+    root.compact(true);
+    REQUIRE(root.frozen());
+    json::node pair(Arr { root, root });
+    auto shared = pair.memory_usage();
+    REQUIRE(shared.elements == root.memory_usage().elements + 2 * sizeof(json::node));
+    REQUIRE(shared.shared == root.memory_usage().shared);
+}
+
+TEST_CASE("test node deep tree destruction", "[node]")
+{
+    using Arr = std::vector<json::node>;
+    using Obj = std::unordered_map<std::string, json::node>;
+
+    // far deeper than the call stack could recurse
+    constexpr std::size_t depth = 200000;
+    auto chain = [](bool frozen) {
+        json::node ret;
+        for (std::size_t i = 0; i < depth; i++) {
+            json::node next;
+            if (i % 2) {
+                Arr arr;
+                arr.push_back(std::move(ret));
+                arr.push_back(json::node(1));
+                next = std::move(arr);
+            } else {
+                Obj obj;
+                obj.emplace("next", std::move(ret));
+                next = std::move(obj);
+            }
+            // children are frozen already, so each level stops at once
+            if (frozen)
+                next.freeze();
+            ret = std::move(next);
+        }
+        return ret;
+    };
+
+    {
+        auto tree = chain(false);
+        REQUIRE(tree.type() == json::node::data_k::array);
+    }
+
+    {
+        auto tree = chain(true);
+        auto snapshot = tree;
+        tree = nullptr;
+        REQUIRE(snapshot.frozen());
+    }
+}
@@ -0,0 +1,58 @@
+#include <catch2/catch_test_macros.hpp>
+#include <mini_json/json.hpp>
+#include <mini_json/reclaim.hpp>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace json = mini_json;
+
+TEST_CASE("test reclaimer drop and flush", "[reclaim]")
+{
+    using Arr = std::vector<json::node>;
+
+    json::reclaimer gc;
+    json::node tree(Arr(1000, json::node("a string beyond small buffer")));
+    auto snapshot = tree;
+    snapshot.freeze();
+
+    gc.drop(std::move(tree));
+    REQUIRE(tree.type() == json::node::data_k::null);
+
+    // frozen trees may be shared with other holders
+    gc.drop(json::node(snapshot));
+    gc.drop(json::node(1));
+    gc.flush();
+
+    REQUIRE(gc.count() == 2);
+    REQUIRE(snapshot.get<Arr>().size() == 1000);
+}
+
+TEST_CASE("test json reclaim previous trees", "[reclaim]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+
+    json::reclaimer gc;
+    json::json parser;
+    parser.reclaim(&gc);
+    REQUIRE(parser.reclaim() == &gc);
+
+    for (int i = 0; i < 100; i++) {
+        auto* root = parser.parse(R"({"a":[1,2,{"b":"c"}],"n":)" + std::to_string(i) + "}");
+        REQUIRE(root);
+        REQUIRE(root->get<Obj>().at("n").as<int>() == i);
+    }
+
+    // a value followed by garbage is handed over as well
+    REQUIRE(!parser.parse(R"({"a":[1,2,{"b":"c"}]} x)"));
+    gc.flush();
+    REQUIRE(gc.count() == 100 + 1);
+
+    // without a reclaimer the previous tree is freed inline again
+    parser.reclaim(nullptr);
+    REQUIRE(parser.parse("[[1]]"));
+    REQUIRE(parser.parse("[[2]]"));
+    gc.flush();
+    REQUIRE(gc.count() == 100 + 1);
+}
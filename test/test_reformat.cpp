@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+#include <mini_json/json.hpp>
+#include <mini_json/reformat.hpp>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace json = mini_json;
+
+static std::string reformat(std::string_view src, json::reformatter::options opts, std::size_t chunk)
+{
+    json::reformatter fmt(opts);
+    std::string ret;
+    auto sink = [&](std::string_view piece) { ret.append(piece); };
+
+    for (std::size_t i = 0; i < src.size(); i += chunk)
+        fmt.feed(src.substr(i, chunk), sink);
+    REQUIRE(fmt.finish(sink));
+    return ret;
+}
+
+TEST_CASE("test reformat minify", "[reformat]")
+{
+    std::string_view src = " { \"a b\" : [ 1.50 , -0e+3, true , null ] ,\n\t\"c\\\" d\" : { } , \"e\":[ ] }\n";
+    std::string_view min = "{\"a b\":[1.50,-0e+3,true,null],\"c\\\" d\":{},\"e\":[]}";
+
+    // one byte chunks split every escape, number and literal
+    for (std::size_t chunk : { std::size_t(1), std::size_t(3), std::size_t(7), src.size() })
+        REQUIRE(reformat(src, {}, chunk) == min);
+
+    // a tiny output buffer flushes in the middle of tokens
+    json::reformatter::options tiny;
+    tiny.buffer = 4;
+    REQUIRE(reformat(src, tiny, 5) == min);
+
+    // consecutive top-level values keep one per line
+    std::string_view lines = "1\n23 \"s\"{\"a\": [1]}\r\n[ ] true\n";
+    std::string_view ndjson = "1\n23\n\"s\"\n{\"a\":[1]}\n[]\ntrue";
+    for (std::size_t chunk : { std::size_t(1), std::size_t(2), std::size_t(5), lines.size() })
+        REQUIRE(reformat(lines, {}, chunk) == ndjson);
+}
+
+TEST_CASE("test reformat pretty", "[reformat]")
+{
+    json::reformatter::options opts;
+    opts.indent = 2;
+
+    std::string_view src = "{\"a\":[1,{\"b\":\"x\"}],\"c\":{},\"d\":[]}";
+    std::string_view pretty = "{\n"
+                              "  \"a\": [\n"
+                              "    1,\n"
+                              "    {\n"
+                              "      \"b\": \"x\"\n"
+                              "    }\n"
+                              "  ],\n"
+                              "  \"c\": {},\n"
+                              "  \"d\": []\n"
+                              "}";
+
+    REQUIRE(reformat(src, opts, 1) == pretty);
+    REQUIRE(reformat(pretty, {}, 2) == src);
+    REQUIRE(reformat("{\"a\":1} [2]", opts, 1) == "{\n  \"a\": 1\n}\n[\n  2\n]");
+}
+
+TEST_CASE("test reformat stream", "[reformat]")
+{
+    std::ifstream fs("../test/demo/test1.json");
+    if (!fs.is_open())
+        throw std::runtime_error("can't open file");
+
+    std::ostringstream os;
+    REQUIRE(json::reformatter::transform(fs, os, {}, 13));
+
+    // the minified text parses to the same tree
+    fs.clear();
+    fs.seekg(0);
+    std::string con { std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>() };
+    json::json orig(std::move(con)), min(os.str());
+    REQUIRE(orig.parse());
+    REQUIRE(min.parse());
+    REQUIRE(*orig.str() == *min.str());
+
+    // unbalanced input is reported
+    std::istringstream bad("[1, [2]");
+    std::ostringstream out;
+    REQUIRE_FALSE(json::reformatter::transform(bad, out));
+
+    // a zero chunk reads the default size instead of spinning
+    std::istringstream two("1 2");
+    std::ostringstream lines;
+    REQUIRE(json::reformatter::transform(two, lines, {}, 0));
+    REQUIRE(lines.str() == "1\n2");
+}
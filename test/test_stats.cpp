@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+#include <mini_json/json.hpp>
+#include <string>
+#include <unordered_map>
+
+namespace json = mini_json;
+
+static_assert(json::json::stats_enabled, "test_stats must be built with MINI_JSON_STATS");
+
+TEST_CASE("test json parse statistics", "[stats]")
+{
+    std::string con = "{\"name\": \"arthur\", \"tags\": [\"a\\tb\", 1, true, null], \"nested\": {\"deep\": [[]]}}";
+    json::json obj(con);
+    REQUIRE(obj.parse());
+
+    auto const& st = obj.stats();
+    using kind = json::node::data_k;
+    REQUIRE(st.bytes_consumed == con.size());
+    REQUIRE(st.nodes[static_cast<std::size_t>(kind::object)] == 2);
+    REQUIRE(st.nodes[static_cast<std::size_t>(kind::array)] == 3);
+    REQUIRE(st.nodes[static_cast<std::size_t>(kind::string)] == 2);
+    REQUIRE(st.nodes[static_cast<std::size_t>(kind::number)] == 1);
+    REQUIRE(st.nodes[static_cast<std::size_t>(kind::boolean)] == 1);
+    REQUIRE(st.nodes[static_cast<std::size_t>(kind::null)] == 1);
+    REQUIRE(st.nodes_total() == 10);
+    REQUIRE(st.max_depth == 4);
+    REQUIRE(st.strings_escaped == 1);
+    REQUIRE(st.strings_plain == 1);
+    REQUIRE(st.allocations > 0);
+    REQUIRE(st.bytes_allocated > 0);
+}
+
+TEST_CASE("test json str statistics", "[stats]")
+{
+    json::json obj("[1, 2, 3]");
+    REQUIRE(obj.parse());
+
+    auto ret = obj.str();
+    REQUIRE(ret);
+    REQUIRE(obj.stats().bytes_written == ret->size());
+    REQUIRE(obj.stats().nodes_total() == 4);
+}
+
+TEST_CASE("test json str cache statistics", "[stats]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    json::json obj("{\"big\": [\"aaaaaaaaaaaaaaaaaaaa\", \"bbbbbbbbbbbbbbbbbbbb\"], \"small\": {\"n\": 1}}");
+    auto root = obj.parse();
+    REQUIRE(root);
+    root->freeze();
+    obj.str_cache(32);
+
+    std::string first = *obj.str();
+    REQUIRE(obj.stats().fragments_reused == 0);
+
+    // only the root qualifies, so the next pass is a single copy
+    REQUIRE(*obj.str() == first);
+    REQUIRE(obj.stats().fragments_reused == 1);
+    REQUIRE(obj.stats().bytes_reused == first.size());
+
+    // mutation regenerates the root, the untouched big array is copied
+    root->get<Obj>().at("small") = 2;
+    obj.str();
+    REQUIRE(obj.stats().fragments_reused == 1);
+    REQUIRE(obj.stats().bytes_reused == std::string("[\"aaaaaaaaaaaaaaaaaaaa\", \"bbbbbbbbbbbbbbbbbbbb\"]").size());
+
+    // cached runs handed out by str_gather are counted before they are pinned
+    std::string whole = *obj.str();
+    auto const* parts = obj.str_gather(1);
+    REQUIRE(parts);
+    std::string joined;
+    for (auto part : *parts)
+        joined.append(part);
+    REQUIRE(joined == whole);
+    REQUIRE(obj.stats().fragments_reused == 1);
+    REQUIRE(obj.stats().bytes_reused == std::string("[\"aaaaaaaaaaaaaaaaaaaa\", \"bbbbbbbbbbbbbbbbbbbb\"]").size());
+}
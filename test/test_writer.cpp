@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <mini_json/json.hpp>
+#include <mini_json/writer.hpp>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace json = mini_json;
+
+TEST_CASE("test writer output", "[writer]")
+{
+    using Obj = std::unordered_map<std::string, json::node>;
+    constexpr json::literal_key quoted("say \"hi\"\n");
+    static_assert(quoted.view() == "\"say \\\"hi\\\"\\n\": ");
+
+    json::json_writer writer;
+    writer.begin_object()
+        .key("list")
+        .begin_array()
+        .value(nullptr)
+        .value(true)
+        .value(-42)
+        .value(0.1)
+        .value(std::nan(""))
+        .value("tab\there \x01")
+        .begin_array()
+        .end_array()
+        .begin_object()
+        .end_object()
+        .end_array()
+        .key(quoted)
+        .value(std::string("caf\xc3\xa9"))
+        .end_object();
+
+    REQUIRE(writer.complete());
+    REQUIRE(writer.view() == "{\"list\": [null, true, -42, 0.1, null, \"tab\\there \\u0001\", [], {}], \"say \\\"hi\\\"\\n\": \"caf\xc3\xa9\"}");
+
+    // the output parses back to the same values
+    json::json parser;
+    auto root = parser.parse(writer.view());
+    REQUIRE(root);
+    REQUIRE(root->get<Obj>().at("say \"hi\"\n").as<std::string>() == "caf\xc3\xa9");
+    REQUIRE(root->get<Obj>().at("list").get<std::vector<json::node>>()[5].as<std::string>() == "tab\there \x01");
+
+    // flushing in parts keeps the structure
+    std::string out;
+    auto sink = [&](std::string_view piece) { out.append(piece); };
+    writer.clear();
+    writer.begin_array().value(1);
+    writer.flush(sink);
+    writer.value(2).end_array();
+    writer.flush(sink);
+    REQUIRE(out == "[1, 2]");
+}
+
+TEST_CASE("test writer structure checks", "[writer]")
+{
+    json::json_writer writer;
+    REQUIRE_THROWS_AS(writer.key("a"), json::bad_write);
+    REQUIRE_THROWS_AS(writer.end_array(), json::bad_write);
+
+    writer.begin_object();
+    REQUIRE_THROWS_AS(writer.value(1), json::bad_write);
+    REQUIRE_THROWS_AS(writer.end_array(), json::bad_write);
+    writer.key("a");
+    REQUIRE_THROWS_AS(writer.key("b"), json::bad_write);
+    REQUIRE_THROWS_AS(writer.end_object(), json::bad_write);
+    writer.value(1).end_object();
+    REQUIRE(writer.complete());
+    REQUIRE_THROWS_AS(writer.value(2), json::bad_write);
+
+    // checking is part of the type, an unchecked writer writes the same text
+    static_assert(!json::unchecked_json_writer::checked);
+    json::unchecked_json_writer fast;
+    fast.begin_object().key("a").value(1).end_object();
+    REQUIRE(fast.view() == writer.view());
+}